@@ -1,41 +1,706 @@
 #include "CJson.h"
-#include <errno.h>
 #include <math.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
 
+#if !defined(CJSON_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define CJSON_SSE2 1
+#include <emmintrin.h>
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define CJSON_AVX2 1
+#include <immintrin.h>
+#endif
+#endif
+
+#ifndef CJSON_NO_THREADS
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <unistd.h>
+#endif
+#endif
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+static int ctz32(unsigned x)
+{
+    unsigned long i;
+    _BitScanForward(&i, x);
+    return (int)i;
+}
+static int ctz64(uint64_t x)
+{
+    unsigned lo = (unsigned)x;
+    return lo ? ctz32(lo) : 32 + ctz32((unsigned)(x >> 32));
+}
+static int popcount64(uint64_t x)
+{
+    x -= (x >> 1) & UINT64_C(0x5555555555555555);
+    x = (x & UINT64_C(0x3333333333333333)) + ((x >> 2) & UINT64_C(0x3333333333333333));
+    x = (x + (x >> 4)) & UINT64_C(0x0F0F0F0F0F0F0F0F);
+    return (int)((x * UINT64_C(0x0101010101010101)) >> 56);
+}
+#else
+#define ctz32(x) __builtin_ctz(x)
+#define ctz64(x) __builtin_ctzll(x)
+#define popcount64(x) __builtin_popcountll(x)
+#endif
+
 #define CONTEXT_STACK_DEFAULT_CAPACITY 500
+#define CJSON_WRITE_BUFFER_SIZE 4096 /* cjson_stringify_to() buffer, on the C stack */
+#define ARENA_DEFAULT_BLOCK_SIZE 8192
+#define ARENA_ALIGN(n) (((n) + 7) & ~(size_t)7)
+
+/* cjson_value.flags bits */
+#define FLAG_NOFREE 0x1u      /* string/array/object buffer is not owned by the value */
+#define FLAG_KEY_NOFREE 0x2u  /* set on a member's value: the member key is not owned */
+#define FLAG_INT64 0x4u       /* number stored exactly in u.i64 */
+#define FLAG_UINT64 0x8u      /* number stored exactly in u.u64 */
+#define FLAG_INLINE 0x10u     /* string stored in the value itself */
+#define FLAG_KEY_INLINE 0x20u /* set on a member's value: the key is stored in the member itself */
+#define FLAG_LAZY 0x40u       /* array/object not decoded yet; u.s holds its source text */
+#define FLAG_BLOCK 0x80u      /* array/object buffer owns the block holding its copied subtree, */
+                              /* or with FLAG_NOFREE: string/array/object cut from such a block */
+#define FLAG_KEY_MASK (FLAG_KEY_NOFREE | FLAG_KEY_INLINE)
+
+/* Short strings are kept in the union of their value, and short keys in the
+ * key and len fields of their member, so neither needs an allocation. The
+ * bytes are NUL-terminated and the length is in the last byte. */
+#define INLINE_STRING_MAX (sizeof(((cjson_value *)0)->u) - 2)
+#define INLINE_KEY_MAX (sizeof(char *) + sizeof(size_t) - 2) /* key and len are adjacent */
+#define INLINE_STRING(v) ((char *)&(v)->u)
+#define INLINE_KEY(m) ((char *)&(m)->key)
+#define VALUE_STRING(v) ((v)->flags & FLAG_INLINE ? INLINE_STRING(v) : (v)->u.s.s)
+#define VALUE_STRING_LENGTH(v) \
+    ((v)->flags & FLAG_INLINE ? (size_t)(unsigned char)INLINE_STRING(v)[INLINE_STRING_MAX + 1] : (size_t)(v)->u.s.len)
+#define MEMBER_KEY(m) ((m)->v.flags & FLAG_KEY_INLINE ? INLINE_KEY(m) : (m)->key)
+#define MEMBER_KEY_LENGTH(m) \
+    ((m)->v.flags & FLAG_KEY_INLINE ? (size_t)(unsigned char)INLINE_KEY(m)[INLINE_KEY_MAX + 1] : (m)->len)
+
+/* A compact value has no room for a capacity, so array and object buffers
+ * keep it in a size_t header in front of the first slot. The buffer pointer
+ * is past the header, and the header is what gets freed. */
+#ifdef CJSON_COMPACT
+#define COMPACT_FITS(n) ((n) <= UINT32_MAX) /* string lengths and container counts */
+#define CONTAINER_HEADER sizeof(size_t)
+#define CONTAINER_CAPACITY(buf) ((buf) ? ((const size_t *)(const void *)(buf))[-1] : 0)
+#define ARRAY_CAPACITY(v) CONTAINER_CAPACITY((v)->u.a.a)
+#define OBJECT_CAPACITY(v) CONTAINER_CAPACITY((v)->u.o.m)
+#define SET_ARRAY_CAPACITY(v, n) ((void)0)
+#define SET_OBJECT_CAPACITY(v, n) ((void)0)
+#else
+#define COMPACT_FITS(n) 1
+#define CONTAINER_HEADER 0
+#define ARRAY_CAPACITY(v) ((v)->u.a.capacity)
+#define OBJECT_CAPACITY(v) ((v)->u.o.capacity)
+#define SET_ARRAY_CAPACITY(v, n) ((v)->u.a.capacity = (n))
+#define SET_OBJECT_CAPACITY(v, n) ((v)->u.o.capacity = (n))
+#endif
+
+typedef struct arena_block
+{
+    struct arena_block *next;
+    size_t size;
+    size_t used;
+} arena_block;
+
+struct cjson_arena
+{
+    arena_block *head;
+    size_t block_size;
+};
+
+/* a parse/stringify stack kept between calls */
+struct cjson_context
+{
+    char *stack;
+    size_t capacity;
+};
+
+/* An open-addressed set of interned keys. The strings are immutable and
+ * live in the table's arena until the table is freed. */
+typedef struct key_table_slot
+{
+    const char *key; /* NULL marks an empty slot */
+    size_t len;
+    uint32_t hash;
+} key_table_slot;
+
+struct cjson_key_table
+{
+    key_table_slot *slots;
+    size_t mask;
+    size_t size;
+    cjson_arena *strings;
+};
+
+typedef struct path_segment
+{
+    const char *key;
+    size_t len;
+    uint32_t hash;
+    size_t index; /* array index spelled by the token, or CJSON_KEY_NOT_EXIST */
+} path_segment;
+
+struct cjson_path
+{
+    size_t count;
+    path_segment segments[1];
+};
+
+/* A projection is a trie of path tokens. A node that ends a path keeps its
+ * whole subtree; the others keep only the members and elements their
+ * children name. */
+typedef struct projection_node
+{
+    path_segment token; /* how the parent reaches this node */
+    struct projection_node *child;
+    struct projection_node *next; /* sibling */
+    size_t elements; /* one past the largest index among the children */
+    int keep;
+} projection_node;
+
+struct cjson_projection
+{
+    projection_node nodes[1]; /* nodes[0] is the root */
+};
 
 typedef struct context
 {
     const char *json;
+    const char *end;
     char *stack;
     size_t top;
     size_t capacity;
+    cjson_arena *arena;
+    cjson_key_table *keys; /* intern keys here instead of copying them */
+    int insitu;
+    int lazy; /* record nested arrays and objects instead of decoding them */
+    const projection_node *project; /* selects what to build here, or NULL for everything */
+    int skip_unvalidated;
+    const char *base;      /* start of the input, for structural index offsets */
+    const uint32_t *index; /* stage-1 structural index, or NULL */
+    size_t index_size;
+    size_t index_pos;
+    cjson_write_fn write; /* stringify sink; the stack is then a fixed buffer */
+    void *userdata;
+    int write_status; /* first non-zero return of write */
 } context;
 static int parse_value(context *c, cjson_value *v);
+static int skip_value(context *c);
+static const projection_node *projection_member(const projection_node *node, const char *key, size_t len);
+static const projection_node *projection_element(const projection_node *node, size_t index);
+
+/* current input byte, or '\0' once the input is exhausted */
+#define PEEK(c) ((c)->json < (c)->end ? *(c)->json : '\0')
+
+#define ARENA_BLOCK_DATA(b) ((char *)(b) + ARENA_ALIGN(sizeof(arena_block)))
+static arena_block *arena_block_new(size_t size, arena_block *next)
+{
+    arena_block *b = (arena_block *)malloc(ARENA_ALIGN(sizeof(arena_block)) + size);
+    b->next = next;
+    b->size = size;
+    b->used = 0;
+    return b;
+}
+
+static void *arena_alloc(cjson_arena *arena, size_t size)
+{
+    arena_block *b = arena->head;
+    size = ARENA_ALIGN(size);
+    if (b == NULL || b->size - b->used < size)
+    {
+        if (b != NULL && size > arena->block_size >> 2)
+        {
+            /* oversized request: give it its own block behind the current one */
+            b->next = arena_block_new(size, b->next);
+            b->next->used = size;
+            return ARENA_BLOCK_DATA(b->next);
+        }
+        b = arena->head = arena_block_new(size > arena->block_size ? size : arena->block_size, b);
+    }
+    char *ret = ARENA_BLOCK_DATA(b) + b->used;
+    b->used += size;
+    return ret;
+}
+
+cjson_arena *cjson_arena_new(size_t block_size)
+{
+    cjson_arena *arena = (cjson_arena *)malloc(sizeof(cjson_arena));
+    arena->head = NULL;
+    arena->block_size = block_size ? ARENA_ALIGN(block_size) : ARENA_DEFAULT_BLOCK_SIZE;
+    return arena;
+}
+
+void cjson_arena_reset(cjson_arena *arena)
+{
+    assert(arena != NULL);
+    arena_block *b = arena->head, *keep = NULL;
+    while (b)
+    {
+        arena_block *next = b->next;
+        if (keep == NULL && b->size == arena->block_size)
+            keep = b;
+        else
+            free(b);
+        b = next;
+    }
+    if (keep)
+    {
+        keep->next = NULL;
+        keep->used = 0;
+    }
+    arena->head = keep;
+}
+
+void cjson_arena_free(cjson_arena *arena)
+{
+    if (arena == NULL)
+        return;
+    arena_block *b = arena->head;
+    while (b)
+    {
+        arena_block *next = b->next;
+        free(b);
+        b = next;
+    }
+    free(arena);
+}
+
+cjson_context *cjson_context_new(void)
+{
+    cjson_context *ctx = (cjson_context *)malloc(sizeof(cjson_context));
+    ctx->stack = NULL;
+    ctx->capacity = 0;
+    return ctx;
+}
+
+void cjson_context_reset(cjson_context *ctx)
+{
+    assert(ctx != NULL);
+    if (ctx->stack)
+        ctx->stack[0] = '\0';
+}
+
+void cjson_context_trim(cjson_context *ctx)
+{
+    assert(ctx != NULL);
+    free(ctx->stack);
+    ctx->stack = NULL;
+    ctx->capacity = 0;
+}
+
+void cjson_context_free(cjson_context *ctx)
+{
+    if (ctx == NULL)
+        return;
+    free(ctx->stack);
+    free(ctx);
+}
+
+static uint32_t key_hash(const char *key, size_t len)
+{
+    uint32_t h = 2166136261u; /* FNV-1a */
+    for (size_t i = 0; i < len; i++)
+        h = (h ^ (unsigned char)key[i]) * 16777619u;
+    return h;
+}
+
+#define KEY_TABLE_DEFAULT_CAPACITY 64
+
+cjson_key_table *cjson_key_table_new(void)
+{
+    cjson_key_table *keys = (cjson_key_table *)malloc(sizeof(cjson_key_table));
+    keys->slots = (key_table_slot *)calloc(KEY_TABLE_DEFAULT_CAPACITY, sizeof(key_table_slot));
+    keys->mask = KEY_TABLE_DEFAULT_CAPACITY - 1;
+    keys->size = 0;
+    keys->strings = cjson_arena_new(0);
+    return keys;
+}
+
+/* the table is kept at most half full, so probe sequences stay short */
+static void key_table_grow(cjson_key_table *keys)
+{
+    size_t mask = 2 * keys->mask + 1;
+    key_table_slot *slots = (key_table_slot *)calloc(mask + 1, sizeof(key_table_slot));
+    for (size_t i = 0; i <= keys->mask; i++)
+    {
+        if (keys->slots[i].key == NULL)
+            continue;
+        size_t j = keys->slots[i].hash & mask;
+        while (slots[j].key)
+            j = (j + 1) & mask;
+        slots[j] = keys->slots[i];
+    }
+    free(keys->slots);
+    keys->slots = slots;
+    keys->mask = mask;
+}
+
+const char *cjson_key_table_intern(cjson_key_table *keys, const char *key, size_t len)
+{
+    assert(keys != NULL && (key != NULL || len == 0));
+    uint32_t hash = key_hash(key, len);
+    size_t j = hash & keys->mask;
+    for (; keys->slots[j].key; j = (j + 1) & keys->mask)
+    {
+        const key_table_slot *e = &keys->slots[j];
+        if (e->hash == hash && e->len == len && (len == 0 || memcmp(e->key, key, len) == 0))
+            return e->key;
+    }
+    if (2 * (keys->size + 1) > keys->mask + 1)
+    {
+        key_table_grow(keys);
+        for (j = hash & keys->mask; keys->slots[j].key; j = (j + 1) & keys->mask)
+            ;
+    }
+    char *copy = (char *)arena_alloc(keys->strings, len + 1);
+    if (len)
+        memcpy(copy, key, len);
+    copy[len] = '\0';
+    keys->slots[j].key = copy;
+    keys->slots[j].len = len;
+    keys->slots[j].hash = hash;
+    keys->size++;
+    return copy;
+}
+
+size_t cjson_key_table_size(const cjson_key_table *keys)
+{
+    assert(keys != NULL);
+    return keys->size;
+}
+
+void cjson_key_table_free(cjson_key_table *keys)
+{
+    if (keys == NULL)
+        return;
+    free(keys->slots);
+    cjson_arena_free(keys->strings);
+    free(keys);
+}
+
+static void *context_alloc(context *c, size_t size)
+{
+    return c->arena ? arena_alloc(c->arena, size) : malloc(size);
+}
+
+static char *context_strdup(context *c, const char *str, size_t len)
+{
+    char *ret = (char *)context_alloc(c, len + 1);
+    if (len)
+        memcpy(ret, str, len);
+    ret[len] = '\0';
+    return ret;
+}
+#define CONTEXT_STORAGE_FLAGS(c) ((c)->arena ? FLAG_NOFREE : 0u)
+#define CONTEXT_BORROWS_KEYS(c) ((c)->arena || (c)->insitu)
+
+/* copies a string of at most max bytes into inline storage of max + 2 bytes */
+static void inline_store(char *dst, size_t max, const char *str, size_t len)
+{
+    assert(len <= max);
+    if (len)
+        memcpy(dst, str, len);
+    dst[len] = '\0';
+    dst[max + 1] = (char)len;
+}
+
+static void context_set_string(context *c, cjson_value *v, const char *str, size_t len)
+{
+    v->type = CJSON_STRING;
+    if (len <= INLINE_STRING_MAX)
+    {
+        v->flags = FLAG_INLINE;
+        inline_store(INLINE_STRING(v), INLINE_STRING_MAX, str, len);
+        return;
+    }
+    v->flags = CONTEXT_STORAGE_FLAGS(c);
+    assert(COMPACT_FITS(len));
+    v->u.s.len = len;
+    v->u.s.s = context_strdup(c, str, len);
+}
+
+/* stores a decoded key in m; returns the FLAG_KEY_* bits that describe it */
+static unsigned context_set_key(context *c, cjson_member *m, const char *key, size_t len)
+{
+    if (c->keys)
+    {
+        /* interned keys stay pointers, so equal keys share one address */
+        m->len = len;
+        m->key = (char *)cjson_key_table_intern(c->keys, key, len);
+        return FLAG_KEY_NOFREE;
+    }
+    if (len <= INLINE_KEY_MAX)
+    {
+        inline_store(INLINE_KEY(m), INLINE_KEY_MAX, key, len);
+        return FLAG_KEY_INLINE;
+    }
+    m->len = len;
+    m->key = context_strdup(c, key, len);
+    return CONTEXT_BORROWS_KEYS(c) ? FLAG_KEY_NOFREE : 0u;
+}
+
+/* key_flags are the FLAG_KEY_* bits of the member */
+static void key_free(cjson_member *m, unsigned key_flags)
+{
+    if (!(key_flags & FLAG_KEY_MASK))
+        free(m->key);
+}
+
+#define ISWHITESPACE(ch) ((ch) == ' ' || (ch) == '\n' || (ch) == '\r' || (ch) == '\t')
+static const char *scan_white_space(const char *p, const char *end)
+{
+#ifdef CJSON_SSE2
+    const __m128i space = _mm_set1_epi8(' '), lf = _mm_set1_epi8('\n'), cr = _mm_set1_epi8('\r'), tab = _mm_set1_epi8('\t');
+    for (; end - p >= 16; p += 16)
+    {
+        __m128i x = _mm_loadu_si128((const __m128i *)p);
+        __m128i ws = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(x, space), _mm_cmpeq_epi8(x, lf)),
+                                  _mm_or_si128(_mm_cmpeq_epi8(x, cr), _mm_cmpeq_epi8(x, tab)));
+        unsigned mask = ~(unsigned)_mm_movemask_epi8(ws) & 0xFFFF;
+        if (mask)
+            return p + ctz32(mask);
+    }
+#endif
+    while (p < end && ISWHITESPACE(*p))
+        p++;
+    return p;
+}
 
 static void skip_white_space(context *c)
 {
     assert(c != NULL && c->json != NULL);
-    const char *c_ = c->json;
-    while (*c_ == '\t' || *c_ == '\n' || *c_ == ' ' || *c_ == '\r')
+    const char *c_ = c->json, *end = c->end;
+    if (c_ == end || !ISWHITESPACE(*c_))
+        return;
+    if (c->index)
+    {
+        /* the first token start past the whitespace is the next index entry */
+        size_t offset = c_ - c->base, i = c->index_pos;
+        while (i < c->index_size && c->index[i] < offset)
+            i++;
+        c->index_pos = i;
+        c->json = (i < c->index_size) ? c->base + c->index[i] : end;
+        return;
+    }
+    c->json = scan_white_space(c_ + 1, end);
+}
+
+/* Stage 1: classify 64-byte blocks into bitmasks and record the offset of
+ * every token start outside strings: structural characters, opening quotes
+ * and the first byte of each literal or number. */
+typedef struct block_masks
+{
+    uint64_t white_space;
+    uint64_t op;
+    uint64_t quote;
+    uint64_t backslash;
+} block_masks;
+
+static void classify_block(const char *p, block_masks *m)
+{
+#ifdef CJSON_SSE2
+    const __m128i space = _mm_set1_epi8(' '), lf = _mm_set1_epi8('\n'), cr = _mm_set1_epi8('\r'), tab = _mm_set1_epi8('\t');
+    const __m128i lower = _mm_set1_epi8(0x20), curly_open = _mm_set1_epi8('{'), curly_close = _mm_set1_epi8('}');
+    const __m128i colon = _mm_set1_epi8(':'), comma = _mm_set1_epi8(','), quote = _mm_set1_epi8('\"'), backslash = _mm_set1_epi8('\\');
+    int i;
+    memset(m, 0, sizeof(*m));
+    for (i = 0; i < 4; i++)
+    {
+        __m128i x = _mm_loadu_si128((const __m128i *)(p + 16 * i));
+        __m128i folded = _mm_or_si128(x, lower); /* '[' -> '{', ']' -> '}' */
+        __m128i ws = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(x, space), _mm_cmpeq_epi8(x, lf)),
+                                  _mm_or_si128(_mm_cmpeq_epi8(x, cr), _mm_cmpeq_epi8(x, tab)));
+        __m128i op = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(folded, curly_open), _mm_cmpeq_epi8(folded, curly_close)),
+                                  _mm_or_si128(_mm_cmpeq_epi8(x, colon), _mm_cmpeq_epi8(x, comma)));
+        m->white_space |= (uint64_t)(unsigned)_mm_movemask_epi8(ws) << (16 * i);
+        m->op |= (uint64_t)(unsigned)_mm_movemask_epi8(op) << (16 * i);
+        m->quote |= (uint64_t)(unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(x, quote)) << (16 * i);
+        m->backslash |= (uint64_t)(unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(x, backslash)) << (16 * i);
+    }
+#else
+    int i;
+    memset(m, 0, sizeof(*m));
+    for (i = 0; i < 64; i++)
+    {
+        uint64_t bit = (uint64_t)1 << i;
+        switch (p[i])
+        {
+        case ' ':
+        case '\n':
+        case '\r':
+        case '\t':
+            m->white_space |= bit;
+            break;
+        case '{':
+        case '}':
+        case '[':
+        case ']':
+        case ':':
+        case ',':
+            m->op |= bit;
+            break;
+        case '\"':
+            m->quote |= bit;
+            break;
+        case '\\':
+            m->backslash |= bit;
+            break;
+        default:
+            break;
+        }
+    }
+#endif
+}
+
+/* bits of characters escaped by a backslash; *carry is set when the block
+ * ends in an unescaped backslash, which escapes the next block's first byte */
+static uint64_t find_escaped(uint64_t backslash, uint64_t *carry)
+{
+    uint64_t escaped = *carry;
+    backslash &= ~escaped;
+    *carry = 0;
+    while (backslash)
+    {
+        int i = ctz64(backslash);
+        if (i == 63)
+        {
+            *carry = 1;
+            break;
+        }
+        escaped |= (uint64_t)2 << i;
+        backslash &= ~((uint64_t)3 << i);
+    }
+    return escaped;
+}
+
+static uint64_t prefix_xor(uint64_t x)
+{
+    x ^= x << 1;
+    x ^= x << 2;
+    x ^= x << 4;
+    x ^= x << 8;
+    x ^= x << 16;
+    x ^= x << 32;
+    return x;
+}
+
+static uint32_t *build_structural_index(const char *json, size_t len, size_t *count)
+{
+    size_t capacity = len / 4 + 64, n = 0, base;
+    uint32_t *index = (uint32_t *)malloc(capacity * sizeof(uint32_t));
+    uint64_t escape_carry = 0, in_string_carry = 0, literal_carry = 0;
+    for (base = 0; base < len; base += 64)
+    {
+        block_masks m;
+        if (len - base >= 64)
+            classify_block(json + base, &m);
+        else
+        {
+            char tail[64];
+            memset(tail, ' ', sizeof(tail));
+            memcpy(tail, json + base, len - base);
+            classify_block(tail, &m);
+        }
+        uint64_t quote = m.quote & ~find_escaped(m.backslash, &escape_carry);
+        uint64_t in_string = prefix_xor(quote) ^ in_string_carry; /* includes opening, excludes closing quote */
+        in_string_carry = (uint64_t)0 - (in_string >> 63);
+        uint64_t literal = ~(m.white_space | m.op | quote | in_string);
+        uint64_t starts = (m.op & ~in_string) | (quote & in_string) | (literal & ~((literal << 1) | literal_carry));
+        literal_carry = literal >> 63;
+        if (n + 64 > capacity)
+        {
+            capacity += capacity >> 1;
+            index = (uint32_t *)realloc(index, capacity * sizeof(uint32_t));
+        }
+        while (starts)
+        {
+            index[n++] = (uint32_t)(base + ctz64(starts));
+            starts &= starts - 1;
+        }
+    }
+    *count = n;
+    return index;
+}
+
+/* Returns the first byte in [p, end) that a JSON string cannot hold
+ * verbatim ('"', '\\' or a control character), or end if there is none. */
+static const char *scan_string_scalar(const char *p, const char *end)
+{
+    while (p < end && (unsigned char)*p >= 0x20 && *p != '\"' && *p != '\\')
+        p++;
+    return p;
+}
+
+#ifdef CJSON_SSE2
+static const char *scan_string_sse2(const char *p, const char *end)
+{
+    const __m128i quote = _mm_set1_epi8('\"'), backslash = _mm_set1_epi8('\\'), ctrl = _mm_set1_epi8(0x1F);
+    for (; end - p >= 16; p += 16)
+    {
+        __m128i x = _mm_loadu_si128((const __m128i *)p);
+        __m128i hit = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(x, quote), _mm_cmpeq_epi8(x, backslash)),
+                                   _mm_cmpeq_epi8(_mm_min_epu8(x, ctrl), x));
+        unsigned mask = (unsigned)_mm_movemask_epi8(hit);
+        if (mask)
+            return p + ctz32(mask);
+    }
+    return scan_string_scalar(p, end);
+}
+#endif
+
+#ifdef CJSON_AVX2
+__attribute__((target("avx2"))) static const char *scan_string_avx2(const char *p, const char *end)
+{
+    const __m256i quote = _mm256_set1_epi8('\"'), backslash = _mm256_set1_epi8('\\'), ctrl = _mm256_set1_epi8(0x1F);
+    for (; end - p >= 32; p += 32)
     {
-        c_++;
+        __m256i x = _mm256_loadu_si256((const __m256i *)p);
+        __m256i hit = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(x, quote), _mm256_cmpeq_epi8(x, backslash)),
+                                      _mm256_cmpeq_epi8(_mm256_min_epu8(x, ctrl), x));
+        unsigned mask = (unsigned)_mm256_movemask_epi8(hit);
+        if (mask)
+            return p + ctz32(mask);
     }
-    c->json = c_;
+    _mm256_zeroupper(); /* compilers omit it before a tail call, and dirty upper halves slow the SSE2 tail */
+    return scan_string_sse2(p, end);
+}
+#endif
+
+static const char *scan_string_dispatch(const char *p, const char *end);
+static const char *(*scan_string)(const char *p, const char *end) = scan_string_dispatch;
+
+/* picks the widest implementation the CPU supports on first use */
+static const char *scan_string_dispatch(const char *p, const char *end)
+{
+#if defined(CJSON_AVX2)
+    scan_string = __builtin_cpu_supports("avx2") ? scan_string_avx2 : scan_string_sse2;
+#elif defined(CJSON_SSE2)
+    scan_string = scan_string_sse2;
+#else
+    scan_string = scan_string_scalar;
+#endif
+    return scan_string(p, end);
 }
 
+/* The stack is allocated on first use and grows by half, so a parse of a
+ * scalar never allocates and pushes are amortized O(1). */
 static void *context_push(context *c, size_t size)
 {
     assert(size > 0);
-    while (c->top + size >= c->capacity)
+    if (c->top + size > c->capacity)
     {
-        c->capacity += c->capacity >> 1;
+        if (c->capacity < CONTEXT_STACK_DEFAULT_CAPACITY)
+            c->capacity = CONTEXT_STACK_DEFAULT_CAPACITY;
+        while (c->top + size > c->capacity)
+            c->capacity += c->capacity >> 1;
+        c->stack = (char *)realloc(c->stack, c->capacity);
     }
-    c->stack = (char *)realloc(c->stack, c->capacity);
     char *ret = c->stack + c->top;
     c->top += size;
     return ret;
@@ -50,8 +715,10 @@ static void *context_pop(context *c, size_t size)
 
 static int parse_word(context *c, cjson_value *v, const char *word, int succ_type)
 {
-    size_t i;
-    for (i = 0; word[i]; i++)
+    size_t i, len = strlen(word);
+    if ((size_t)(c->end - c->json) < len)
+        return CJSON_INVALID_VALUE;
+    for (i = 0; i < len; i++)
     {
         if ((c->json)[i] != word[i])
             return CJSON_INVALID_VALUE;
@@ -63,51 +730,125 @@ static int parse_word(context *c, cjson_value *v, const char *word, int succ_typ
 
 #define ISDIGIT1TO9(ch) ((ch) >= '1' && (ch) <= '9')
 #define ISDIGIT(ch) ((ch) >= '0' && (ch) <= '9')
+#define NUMBER_SCRATCH_SIZE 64
+#define NUMBER_MAX_EXACT_MANTISSA ((uint64_t)1 << 53)
+#define NUMBER_MAX_EXACT_POW10 22
+
+static const double pow10_exact[NUMBER_MAX_EXACT_POW10 + 1] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+/* a validated literal that missed the fast path, correctly rounded without
+ * strtod; defined with the bignum code used by format_double() */
+static int number_slow_path(const char *json, size_t len, double *n);
+
+/* Validates the grammar while accumulating the significant digits that fit
+ * in 64 bits and the decimal exponent. Integral literals that fit are kept
+ * exactly as int64/uint64. Mantissas up to 2^53 scaled by at most 10^22 are
+ * exact doubles, so one correctly rounded multiply or divide gives the
+ * exact result (Clinger's fast path); everything else goes through
+ * number_slow_path(). */
 static int parse_number(context *c, cjson_value *v)
 {
-    const char *p = c->json;
-    if (*p == '-')
+    const char *p = c->json, *end = c->end;
+    uint64_t mantissa = 0;
+    int negative = 0, truncated = 0, integral = 1, exponent = 0;
+#define CH (p < end ? *p : '\0')
+#define ACCUMULATE(ch)                                                                                \
+    do                                                                                                \
+    {                                                                                                 \
+        unsigned d_ = (unsigned)((ch) - '0');                                                         \
+        if (mantissa < UINT64_MAX / 10 || (mantissa == UINT64_MAX / 10 && d_ <= UINT64_MAX % 10)) \
+            mantissa = mantissa * 10 + d_;                                                            \
+        else                                                                                          \
+            truncated = 1;                                                                            \
+    } while (0)
+    if (CH == '-')
+    {
+        negative = 1;
         p++;
-    if (*p == '0')
+    }
+    if (CH == '0')
         p++;
     else
     {
-        if (!ISDIGIT1TO9(*p))
+        if (!ISDIGIT1TO9(CH))
             return CJSON_INVALID_VALUE;
-        for (p++; ISDIGIT(*p); p++)
-            ;
+        for (; ISDIGIT(CH); p++)
+            ACCUMULATE(*p);
     }
-    if (*p == '.')
+    if (CH == '.')
     {
         p++;
-        if (!ISDIGIT(*p))
+        integral = 0;
+        if (!ISDIGIT(CH))
             return CJSON_INVALID_VALUE;
-        for (p++; ISDIGIT(*p); p++)
-            ;
+        for (; ISDIGIT(CH); p++)
+        {
+            ACCUMULATE(*p);
+            exponent--;
+        }
     }
-    if (*p == 'e' || *p == 'E')
+    if (CH == 'e' || CH == 'E')
     {
+        int e = 0, e_negative = 0;
         p++;
-        if (*p == '+' || *p == '-')
-            p++;
-        if (!ISDIGIT(*p))
+        integral = 0;
+        if (CH == '+' || CH == '-')
+            e_negative = (*p++ == '-');
+        if (!ISDIGIT(CH))
             return CJSON_INVALID_VALUE;
-        for (p++; ISDIGIT(*p); p++)
-            ;
+        for (; ISDIGIT(CH); p++)
+        {
+            if (e < 100000)
+                e = e * 10 + (*p - '0');
+        }
+        exponent += e_negative ? -e : e;
+    }
+#undef ACCUMULATE
+#undef CH
+    v->flags &= FLAG_KEY_MASK;
+    if (integral && !truncated && !(negative && mantissa == 0))
+    {
+        if (!negative && mantissa > (uint64_t)INT64_MAX)
+        {
+            v->flags |= FLAG_UINT64;
+            v->u.u64 = mantissa;
+        }
+        else if (!negative || mantissa <= (uint64_t)INT64_MAX + 1)
+        {
+            v->flags |= FLAG_INT64;
+            v->u.i64 = negative ? (int64_t)(0 - mantissa) : (int64_t)mantissa;
+        }
+        else
+            v->u.n = -(double)mantissa;
+    }
+    else if (!truncated && mantissa == 0)
+        v->u.n = negative ? -0.0 : 0.0;
+    else if (!truncated && mantissa <= NUMBER_MAX_EXACT_MANTISSA &&
+             exponent >= -NUMBER_MAX_EXACT_POW10 && exponent <= NUMBER_MAX_EXACT_POW10)
+    {
+        double d = (double)mantissa;
+        d = (exponent < 0) ? d / pow10_exact[-exponent] : d * pow10_exact[exponent];
+        v->u.n = negative ? -d : d;
+    }
+    else
+    {
+        int ret = number_slow_path(c->json, p - c->json, &v->u.n);
+        if (ret != CJSON_PARSE_OK)
+            return ret;
     }
-    errno = 0;
-    v->u.n = strtod(c->json, NULL);
-    if (errno == ERANGE && (v->u.n == HUGE_VAL || v->u.n == -HUGE_VAL))
-        return CJSON_NUMBER_TOO_BIG;
     v->type = CJSON_NUMBER;
     c->json = p;
     return CJSON_PARSE_OK;
 }
 
-static const char *parse_hex4(const char *p, unsigned *u)
+static const char *parse_hex4(const char *p, const char *end, unsigned *u)
 {
     int i;
     *u = 0;
+    if (end - p < 4)
+        return NULL;
     for (i = 0; i < 4; i++)
     {
         char ch = *p++;
@@ -153,33 +894,117 @@ static void encode_utf8(context *c, unsigned u)
     }
 }
 
-#define STRING_ERROR(error) \
-    do                      \
-    {                       \
-        c->top = top;       \
-        return error;       \
-    } while (0)
-static int parse_string_raw(context *c, char **str, size_t *len)
+/* reads the hex digits of a \\u escape, joining a surrogate pair; returns
+ * the end of the escape, or NULL with *error set */
+static const char *parse_unicode_escape(const char *p, const char *end, unsigned *u, int *error)
 {
-    skip_white_space(c);
-    assert(*c->json == '\"');
-    size_t top = c->top;
-    unsigned u, u2;
-    const char *p = c->json;
-    p++;
-    while (1)
+    unsigned u2;
+    if (!(p = parse_hex4(p, end, u)))
     {
-        char ch = *p++;
-        switch (ch)
+        *error = CJSON_INVALID_UNICODE_HEX;
+        return NULL;
+    }
+    if (*u >= 0xD800 && *u <= 0xDBFF)
+    { /* surrogate pair */
+        if (end - p < 2 || p[0] != '\\' || p[1] != 'u')
         {
-        case '\"':
-            *len = c->top - top;
-            *str = (*len) ? (char *)context_pop(c, *len) : NULL;
-            c->json = p;
+            *error = CJSON_INVALID_UNICODE_SURROGATE;
+            return NULL;
+        }
+        if (!(p = parse_hex4(p + 2, end, &u2)))
+        {
+            *error = CJSON_INVALID_UNICODE_HEX;
+            return NULL;
+        }
+        if (u2 < 0xDC00 || u2 > 0xDFFF)
+        {
+            *error = CJSON_INVALID_UNICODE_SURROGATE;
+            return NULL;
+        }
+        *u = (((*u - 0xD800) << 10) | (u2 - 0xDC00)) + 0x10000;
+    }
+    return p;
+}
+
+/* checks the string at c->json like parse_string_raw() without decoding it */
+static int skip_string(context *c)
+{
+    const char *p = c->json + 1, *end = c->end;
+    unsigned u;
+    int error;
+    while (1)
+    {
+        if ((p = scan_string(p, end)) == end)
+            return CJSON_INVALID_STRING_MISS_QUOTATION;
+        switch (*p++)
+        {
+        case '\"':
+            c->json = p;
             return CJSON_PARSE_OK;
-        case '\0':
+        case '\\':
+            if (p == end)
+                return CJSON_INVALID_STRING_MISS_QUOTATION;
+            switch (*p++)
+            {
+            case '\"':
+            case '\\':
+            case '/':
+            case 'b':
+            case 'f':
+            case 'n':
+            case 'r':
+            case 't':
+                break;
+            case 'u':
+                if (!(p = parse_unicode_escape(p, end, &u, &error)))
+                    return error;
+                break;
+            default:
+                return CJSON_INVALID_STRING_ESCAPE;
+            }
+            break;
+        default:
+            return CJSON_INVALID_STRING_CHAR;
+        }
+    }
+}
+
+#define STRING_ERROR(error) \
+    do                      \
+    {                       \
+        c->top = top;       \
+        return error;       \
+    } while (0)
+static int parse_string_raw(context *c, char **str, size_t *len)
+{
+    skip_white_space(c);
+    assert(PEEK(c) == '\"');
+    size_t top = c->top;
+    unsigned u;
+    int error;
+    const char *p = c->json, *end = c->end;
+    p++;
+    while (1)
+    {
+        const char *run = scan_string(p, end);
+        if (run != p)
+        {
+            memcpy(context_push(c, run - p), p, run - p);
+            p = run;
+        }
+        if (p == end)
             STRING_ERROR(CJSON_INVALID_STRING_MISS_QUOTATION);
+        char ch = *p++;
+        switch (ch)
+        {
+        case '\"':
+            *len = c->top - top;
+            *str = (*len) ? (char *)context_pop(c, *len) : NULL;
+            c->json = p;
+            return CJSON_PARSE_OK;
         case '\\':
+            if (p == end)
+                STRING_ERROR(CJSON_INVALID_STRING_MISS_QUOTATION);
             switch (*p++)
             {
             case '\"':
@@ -207,20 +1032,8 @@ static int parse_string_raw(context *c, char **str, size_t *len)
                 PUTC(c, '\t');
                 break;
             case 'u':
-                if (!(p = parse_hex4(p, &u)))
-                    STRING_ERROR(CJSON_INVALID_UNICODE_HEX);
-                if (u >= 0xD800 && u <= 0xDBFF)
-                { /* surrogate pair */
-                    if (*p++ != '\\')
-                        STRING_ERROR(CJSON_INVALID_UNICODE_SURROGATE);
-                    if (*p++ != 'u')
-                        STRING_ERROR(CJSON_INVALID_UNICODE_SURROGATE);
-                    if (!(p = parse_hex4(p, &u2)))
-                        STRING_ERROR(CJSON_INVALID_UNICODE_HEX);
-                    if (u2 < 0xDC00 || u2 > 0xDFFF)
-                        STRING_ERROR(CJSON_INVALID_UNICODE_SURROGATE);
-                    u = (((u - 0xD800) << 10) | (u2 - 0xDC00)) + 0x10000;
-                }
+                if (!(p = parse_unicode_escape(p, end, &u, &error)))
+                    STRING_ERROR(error);
                 encode_utf8(c, u);
                 break;
             default:
@@ -228,34 +1041,437 @@ static int parse_string_raw(context *c, char **str, size_t *len)
             }
             break;
         default:
-            if ((unsigned char)ch < 0x20)
-                STRING_ERROR(CJSON_INVALID_STRING_CHAR);
-            PUTC(c, ch);
-            break;
+            STRING_ERROR(CJSON_INVALID_STRING_CHAR);
         }
     }
 }
 
+/* In-situ strings are NUL-terminated where their closing quote was.
+ * Escape-free strings are used as they are; others are decoded on the
+ * stack and copied back, as decoding never makes a string longer. */
+static int parse_string_insitu(context *c, char **str, size_t *len)
+{
+    int ret;
+    char *decoded;
+    skip_white_space(c);
+    char *head = (char *)c->json + 1, *end = (char *)c->end;
+    char *p = head + (scan_string(head, end) - head);
+    if (p < end && *p == '\"')
+    {
+        *p = '\0';
+        *str = head;
+        *len = p - head;
+        c->json = p + 1;
+        return CJSON_PARSE_OK;
+    }
+    if ((ret = parse_string_raw(c, &decoded, len)) != CJSON_PARSE_OK)
+        return ret;
+    if (*len)
+        memcpy(head, decoded, *len);
+    head[*len] = '\0';
+    *str = head;
+    return CJSON_PARSE_OK;
+}
+
 static int parse_string(context *c, cjson_value *v)
 {
     int ret;
     size_t len;
     char *str;
-    if ((ret = parse_string_raw(c, &str, &len)) == CJSON_PARSE_OK)
-        cjson_set_string(v, str, len);
+    if (c->insitu)
+    {
+        if ((ret = parse_string_insitu(c, &str, &len)) == CJSON_PARSE_OK)
+        {
+            v->type = CJSON_STRING;
+            v->flags = FLAG_NOFREE;
+            v->u.s.len = len;
+            v->u.s.s = str;
+        }
+    }
+    else if ((ret = parse_string_raw(c, &str, &len)) == CJSON_PARSE_OK)
+        context_set_string(c, v, str, len);
     return ret;
 }
 
+/* turns a block of CONTAINER_HEADER + slot bytes into a buffer of capacity slots */
+static void *container_buffer(void *block, size_t capacity)
+{
+#ifdef CJSON_COMPACT
+    assert(COMPACT_FITS(capacity));
+    *(size_t *)block = capacity;
+#else
+    (void)capacity;
+#endif
+    return (char *)block + CONTAINER_HEADER;
+}
+
+static void container_free(void *buf)
+{
+    if (buf != NULL)
+        free((char *)buf - CONTAINER_HEADER);
+}
+
+/* A FLAG_BLOCK buffer is preceded by a pointer to the block that holds the
+ * rest of its subtree (see cjson_copy()), or by NULL while the buffer still
+ * starts that block itself. */
+#define BLOCK_OWNER ARENA_ALIGN(sizeof(void *))
+#define BLOCK_OWNER_OF(buf) ((void **)((char *)(buf) - CONTAINER_HEADER - BLOCK_OWNER))
+
+/* releases the buffer of an array or object with the given flags */
+static void container_release(void *buf, unsigned flags)
+{
+    if (flags & FLAG_NOFREE)
+        return;
+    if (flags & FLAG_BLOCK)
+    {
+        free(*BLOCK_OWNER_OF(buf));
+        free(BLOCK_OWNER_OF(buf));
+    }
+    else
+        container_free(buf);
+}
+
+/* moves a container buffer to a heap block of bytes holding capacity slots,
+ * keeping its first used bytes. A borrowed (arena) buffer is copied instead,
+ * and so is one that starts a copied subtree, which must stay in place. */
+static void *container_realloc(void *buf, unsigned flags, size_t used, size_t bytes, size_t capacity)
+{
+    size_t front = CONTAINER_HEADER + ((flags & FLAG_BLOCK) ? BLOCK_OWNER : 0);
+    char *start = (buf != NULL) ? (char *)buf - front : NULL;
+    int copy = (flags & FLAG_NOFREE) || ((flags & FLAG_BLOCK) && *(void **)start == NULL);
+    char *block = (char *)realloc(copy ? NULL : start, front + bytes);
+    if (copy && used)
+        memcpy(block + front, buf, used);
+    if ((flags & FLAG_BLOCK) && copy)
+        *(void **)block = start;
+    return container_buffer(block + front - CONTAINER_HEADER, capacity);
+}
+
+/* geometric growth keeps appending amortized O(1) */
+static size_t container_grow(size_t capacity, size_t needed)
+{
+    size_t n = capacity < 4 ? 4 : capacity * 2;
+    assert(COMPACT_FITS(needed));
+    return (n < needed || !COMPACT_FITS(n)) ? needed : n;
+}
+
+static void context_set_array(context *c, cjson_value *v, size_t size)
+{
+    v->type = CJSON_ARRAY;
+    v->flags = CONTEXT_STORAGE_FLAGS(c);
+    SET_ARRAY_CAPACITY(v, size);
+    v->u.a.size = 0;
+    v->u.a.a = (size > 0) ? (cjson_value *)container_buffer(context_alloc(c, CONTAINER_HEADER + sizeof(cjson_value) * size), size) : NULL;
+}
+
+/* Objects with at least OBJECT_INDEX_MIN member slots carry one extra pointer
+ * after m[capacity] for a hash index over their keys. Smaller objects keep the
+ * plain layout and are searched linearly. */
+#define OBJECT_INDEX_MIN 16
+#define OBJECT_BUFFER_SIZE(capacity) \
+    (sizeof(cjson_member) * (capacity) + ((capacity) >= OBJECT_INDEX_MIN ? sizeof(object_index *) : 0))
+#define OBJECT_INDEX(v) (*(object_index **)((v)->u.o.m + OBJECT_CAPACITY(v)))
+
+typedef struct object_index_slot
+{
+    uint32_t hash;
+    uint32_t pos; /* member index + 1, 0 marks an empty slot */
+} object_index_slot;
+
+typedef struct object_index
+{
+    size_t size; /* u.o.size the index was built for */
+    size_t mask;
+    object_index_slot slots[1];
+} object_index;
+
+static size_t object_index_bytes(size_t size, size_t *mask)
+{
+    size_t n = 2 * OBJECT_INDEX_MIN;
+    while (n < 2 * size)
+        n <<= 1;
+    *mask = n - 1;
+    return sizeof(object_index) + sizeof(object_index_slot) * (n - 1);
+}
+
+/* fills an index allocated with object_index_bytes(); duplicate keys keep
+ * their document order along the probe sequence, so the first one wins */
+static object_index *object_index_build(object_index *idx, const cjson_value *v, size_t mask)
+{
+    memset(idx->slots, 0, sizeof(object_index_slot) * (mask + 1));
+    idx->size = v->u.o.size;
+    idx->mask = mask;
+    for (size_t i = 0; i < v->u.o.size; i++)
+    {
+        uint32_t h = key_hash(MEMBER_KEY(&v->u.o.m[i]), MEMBER_KEY_LENGTH(&v->u.o.m[i]));
+        size_t j = h & mask;
+        while (idx->slots[j].pos)
+            j = (j + 1) & mask;
+        idx->slots[j].hash = h;
+        idx->slots[j].pos = (uint32_t)(i + 1);
+    }
+    return idx;
+}
+
+static void context_set_object(context *c, cjson_value *v, size_t size)
+{
+    v->type = CJSON_OBJECT;
+    v->flags = CONTEXT_STORAGE_FLAGS(c);
+    SET_OBJECT_CAPACITY(v, size);
+    v->u.o.size = 0;
+    v->u.o.m = (size > 0) ? (cjson_member *)container_buffer(context_alloc(c, CONTAINER_HEADER + OBJECT_BUFFER_SIZE(size)), size) : NULL;
+    if (size >= OBJECT_INDEX_MIN)
+        OBJECT_INDEX(v) = NULL;
+}
+
+static void member_free(cjson_member *m)
+{
+    key_free(m, m->v.flags);
+    cjson_free(&m->v);
+}
+
+/* gives a value cut from a copy block (see cjson_copy()) buffers of its own,
+ * so that it can outlive the block. Parts below it that were cut from the
+ * block are detached too; other values never have such parts below them. */
+static void value_detach(cjson_value *v)
+{
+    size_t size;
+    if ((v->flags & (FLAG_NOFREE | FLAG_BLOCK)) != (FLAG_NOFREE | FLAG_BLOCK))
+        return;
+    switch (v->type)
+    {
+    case CJSON_STRING:
+        v->u.s.s = (char *)memcpy(malloc(v->u.s.len + 1), v->u.s.s, v->u.s.len + 1);
+        break;
+    case CJSON_ARRAY:
+        size = v->u.a.size;
+        v->u.a.a = (size > 0) ? (cjson_value *)container_realloc(v->u.a.a, FLAG_NOFREE, sizeof(cjson_value) * size,
+                                                                 sizeof(cjson_value) * size, size)
+                              : NULL;
+        SET_ARRAY_CAPACITY(v, size);
+        for (size_t i = 0; i < size; i++)
+            value_detach(&v->u.a.a[i]);
+        break;
+    case CJSON_OBJECT:
+        size = v->u.o.size;
+        v->u.o.m = (size > 0) ? (cjson_member *)container_realloc(v->u.o.m, FLAG_NOFREE, sizeof(cjson_member) * size,
+                                                                  OBJECT_BUFFER_SIZE(size), size)
+                              : NULL;
+        SET_OBJECT_CAPACITY(v, size);
+        if (size >= OBJECT_INDEX_MIN)
+            OBJECT_INDEX(v) = NULL;
+        for (size_t i = 0; i < size; i++)
+        {
+            cjson_member *m = &v->u.o.m[i];
+            if (m->v.flags & FLAG_KEY_NOFREE) /* members added since the copy own their keys */
+            {
+                m->key = (char *)memcpy(malloc(m->len + 1), m->key, m->len + 1);
+                m->v.flags &= ~FLAG_KEY_NOFREE;
+            }
+            value_detach(&m->v);
+        }
+        break;
+    default:
+        break;
+    }
+    v->flags &= ~(FLAG_NOFREE | FLAG_BLOCK);
+}
+
+/* moves src into dst without copying its content and leaves src null; both
+ * keep their own key flags, since those describe the enclosing member. A
+ * value cut from a copy block is detached first. */
+static void value_move(cjson_value *dst, cjson_value *src)
+{
+    unsigned key_flags = dst->flags & FLAG_KEY_MASK;
+    value_detach(src);
+    *dst = *src;
+    dst->flags = (src->flags & ~FLAG_KEY_MASK) | key_flags;
+    src->type = CJSON_NULL;
+    src->flags &= FLAG_KEY_MASK;
+}
+
+/* moves the top size elements of the stack into a new array */
+static void context_close_array(context *c, cjson_value *v, size_t size)
+{
+    context_set_array(c, v, size);
+    if (size > 0)
+        memcpy(v->u.a.a, context_pop(c, size * sizeof(cjson_value)), size * sizeof(cjson_value));
+    v->u.a.size = size;
+}
+
+/* moves the top size members of the stack into a new object */
+static void context_close_object(context *c, cjson_value *v, size_t size)
+{
+    context_set_object(c, v, size);
+    if (size > 0)
+        memcpy(v->u.o.m, context_pop(c, sizeof(cjson_member) * size), sizeof(cjson_member) * size);
+    v->u.o.size = size;
+    if (c->arena && size >= OBJECT_INDEX_MIN)
+    {
+        /* arena buffers are never freed one by one, so build the index now
+           in the arena rather than malloc it on first lookup */
+        size_t mask, bytes = object_index_bytes(size, &mask);
+        OBJECT_INDEX(v) = object_index_build((object_index *)context_alloc(c, bytes), v, mask);
+    }
+}
+
+/* On-demand parsing. The document is validated once up front, so a
+ * container can be recorded by its source text and skipped without
+ * checking it again. It is decoded one level at a time when a getter
+ * first needs its children. */
+/* bits of the opening and closing brackets and braces, quotes and
+ * backslashes in a 64-byte block */
+typedef struct bracket_masks
+{
+    uint64_t open;
+    uint64_t close;
+    uint64_t quote;
+    uint64_t backslash;
+} bracket_masks;
+
+static void classify_brackets(const char *p, bracket_masks *m)
+{
+#ifdef CJSON_SSE2
+    const __m128i lower = _mm_set1_epi8(0x20), curly_open = _mm_set1_epi8('{'), curly_close = _mm_set1_epi8('}');
+    const __m128i quote = _mm_set1_epi8('\"'), backslash = _mm_set1_epi8('\\');
+    int i;
+    memset(m, 0, sizeof(*m));
+    for (i = 0; i < 4; i++)
+    {
+        __m128i x = _mm_loadu_si128((const __m128i *)(p + 16 * i));
+        __m128i folded = _mm_or_si128(x, lower); /* '[' -> '{', ']' -> '}' */
+        m->open |= (uint64_t)(unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(folded, curly_open)) << (16 * i);
+        m->close |= (uint64_t)(unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(folded, curly_close)) << (16 * i);
+        m->quote |= (uint64_t)(unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(x, quote)) << (16 * i);
+        m->backslash |= (uint64_t)(unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(x, backslash)) << (16 * i);
+    }
+#else
+    int i;
+    memset(m, 0, sizeof(*m));
+    for (i = 0; i < 64; i++)
+    {
+        uint64_t bit = (uint64_t)1 << i;
+        switch (p[i])
+        {
+        case '[':
+        case '{':
+            m->open |= bit;
+            break;
+        case ']':
+        case '}':
+            m->close |= bit;
+            break;
+        case '\"':
+            m->quote |= bit;
+            break;
+        case '\\':
+            m->backslash |= bit;
+            break;
+        default:
+            break;
+        }
+    }
+#endif
+}
+
+/* End of the validated array or object at p. Blocks are classified like
+ * in build_structural_index(), and only brackets outside strings count;
+ * a block that cannot close the container is skipped by popcount. Returns
+ * NULL if the input ends first, which only unvalidated input can do. */
+static const char *skip_validated_container(const char *p, const char *end)
+{
+    uint64_t escape_carry = 0, in_string_carry = 0;
+    size_t depth = 0;
+    for (; p < end; p += 64)
+    {
+        bracket_masks m;
+        if (end - p >= 64)
+            classify_brackets(p, &m);
+        else
+        {
+            char tail[64];
+            memset(tail, ' ', sizeof(tail));
+            memcpy(tail, p, end - p);
+            classify_brackets(tail, &m);
+        }
+        uint64_t quote = m.quote & ~find_escaped(m.backslash, &escape_carry);
+        uint64_t in_string = prefix_xor(quote) ^ in_string_carry;
+        in_string_carry = (uint64_t)0 - (in_string >> 63);
+        uint64_t open = m.open & ~in_string, close = m.close & ~in_string;
+        if (depth > (size_t)popcount64(close))
+        {
+            depth += popcount64(open) - popcount64(close);
+            continue;
+        }
+        for (uint64_t bits = open | close; bits; bits &= bits - 1)
+        {
+            int i = ctz64(bits);
+            if (open >> i & 1)
+                depth++;
+            else if (--depth == 0)
+                return p + i + 1;
+        }
+    }
+    return NULL;
+}
+
+static void lazy_record(cjson_value *v, const char *start, const char *stop)
+{
+    assert(COMPACT_FITS(stop - start));
+    v->type = (*start == '[') ? CJSON_ARRAY : CJSON_OBJECT;
+    v->flags = FLAG_LAZY;
+    v->u.s.s = (char *)start;
+    v->u.s.len = stop - start;
+}
+
+static int parse_lazy(context *c, cjson_value *v)
+{
+    const char *start = c->json;
+    c->json = skip_validated_container(start, c->end);
+    assert(c->json != NULL);
+    lazy_record(v, start, c->json);
+    return CJSON_PARSE_OK;
+}
+
+static int parse_array(context *c, cjson_value *v);
+int parse_object(context *c, cjson_value *v);
+
+/* decodes one level of a lazy container; nested containers stay lazy */
+static void lazy_materialize(cjson_value *v)
+{
+    context c;
+    cjson_value tmp;
+    int ret;
+    memset(&c, 0, sizeof(context));
+    c.json = c.base = v->u.s.s;
+    c.end = c.json + v->u.s.len;
+    c.lazy = 1;
+    cjson_init(&tmp);
+    ret = (v->type == CJSON_ARRAY) ? parse_array(&c, &tmp) : parse_object(&c, &tmp);
+    assert(ret == CJSON_PARSE_OK && c.top == 0);
+    (void)ret;
+    free(c.stack);
+    tmp.flags |= v->flags & FLAG_KEY_MASK;
+    *v = tmp;
+}
+#define LAZY_MATERIALIZE(v)                            \
+    do                                                 \
+    {                                                  \
+        if ((v)->flags & FLAG_LAZY)                    \
+            lazy_materialize((cjson_value *)(v));      \
+    } while (0)
+
 static int parse_array(context *c, cjson_value *v)
 {
-    assert(c != NULL && v != NULL && *c->json == '[');
-    size_t size = 0;
+    assert(c != NULL && v != NULL && PEEK(c) == '[');
+    const projection_node *project = c->project, *selected;
+    size_t size = 0, i = 0;
     c->json++;
     skip_white_space(c);
     int ret;
-    if (*c->json == ']')
+    if (PEEK(c) == ']')
     {
-        cjson_set_array(v, 0);
+        context_set_array(c, v, 0);
         c->json++;
         return CJSON_PARSE_OK;
     }
@@ -263,22 +1479,35 @@ static int parse_array(context *c, cjson_value *v)
     {
         cjson_value a;
         cjson_init(&a);
-        if ((ret = parse_value(c, &a)) != CJSON_PARSE_OK)
-            break;
-        memcpy(context_push(c, sizeof(cjson_value)), &a, sizeof(cjson_value));
-        size++;
+        if (project && (selected = projection_element(project, i++)) == NULL)
+        {
+            if ((ret = skip_value(c)) != CJSON_PARSE_OK)
+                break;
+            /* a null stands in for an unselected element before the last
+             * selected one, so that paths still resolve in the result */
+            if (i <= project->elements)
+                memcpy(context_push(c, sizeof(cjson_value)), &a, sizeof(cjson_value)), size++;
+        }
+        else
+        {
+            c->project = (project && !selected->keep) ? selected : NULL;
+            ret = parse_value(c, &a);
+            c->project = project;
+            if (ret != CJSON_PARSE_OK)
+                break;
+            memcpy(context_push(c, sizeof(cjson_value)), &a, sizeof(cjson_value));
+            size++;
+        }
         skip_white_space(c);
-        if (*c->json == ',')
+        if (PEEK(c) == ',')
         {
             c->json++;
             skip_white_space(c);
         }
-        else if (*c->json == ']')
+        else if (PEEK(c) == ']')
         {
             c->json++;
-            cjson_set_array(v, size);
-            memcpy(v->u.a.a, context_pop(c, size * sizeof(cjson_value)), size * sizeof(cjson_value));
-            v->u.a.size = size;
+            context_close_array(c, v, size);
             return CJSON_PARSE_OK;
         }
         else
@@ -298,14 +1527,15 @@ static int parse_array(context *c, cjson_value *v)
 
 int parse_object(context *c, cjson_value *v)
 {
-    assert(c != NULL && v != NULL && *c->json == '{');
+    assert(c != NULL && v != NULL && PEEK(c) == '{');
+    const projection_node *project = c->project, *selected = NULL;
     size_t size = 0;
     int ret;
     c->json++;
     skip_white_space(c);
-    if (*c->json == '}')
+    if (PEEK(c) == '}')
     {
-        cjson_set_object(v, 0);
+        context_set_object(c, v, 0);
         c->json++;
         return CJSON_PARSE_OK;
     }
@@ -314,44 +1544,69 @@ int parse_object(context *c, cjson_value *v)
         cjson_member m;
         cjson_init(&m.v);
         char *key = NULL;
-        if (*c->json != '\"')
+        size_t klen;
+        unsigned key_flags = 0;
+        int skip = 0;
+        if (PEEK(c) != '\"')
         {
             ret = CJSON_MISS_KEY;
             break;
         }
-        if ((ret = parse_string_raw(c, &key, &m.len)) != CJSON_PARSE_OK)
+        if (c->insitu)
         {
-            break;
+            assert(project == NULL);
+            if ((ret = parse_string_insitu(c, &m.key, &m.len)) != CJSON_PARSE_OK)
+                break;
+            key_flags = FLAG_KEY_NOFREE;
+        }
+        else
+        {
+            if ((ret = parse_string_raw(c, &key, &klen)) != CJSON_PARSE_OK)
+                break;
+            /* an unselected key is compared on the stack and never stored */
+            if (project && (selected = projection_member(project, key, klen)) == NULL)
+                skip = 1;
+            else
+                key_flags = context_set_key(c, &m, key, klen);
         }
-        memcpy((m.key = (char *)malloc(sizeof(char) * (m.len + 1))), key, m.len);
-        m.key[m.len] = '\0';
         skip_white_space(c);
-        if (*c->json != ':')
+        if (PEEK(c) != ':')
         {
-            free(m.key);
+            if (!skip)
+                key_free(&m, key_flags);
             ret = CJSON_MISS_COLON;
             break;
         }
         c->json++;
-        if ((ret = parse_value(c, &(m.v))) != CJSON_PARSE_OK)
+        if (skip)
         {
-            free(m.key);
-            break;
+            if ((ret = skip_value(c)) != CJSON_PARSE_OK)
+                break;
+        }
+        else
+        {
+            c->project = (project && !selected->keep) ? selected : NULL;
+            ret = parse_value(c, &(m.v));
+            c->project = project;
+            if (ret != CJSON_PARSE_OK)
+            {
+                key_free(&m, key_flags);
+                break;
+            }
+            m.v.flags |= key_flags;
+            memcpy(context_push(c, sizeof(cjson_member)), &m, sizeof(cjson_member));
+            size++;
         }
-        memcpy(context_push(c, sizeof(cjson_member)), &m, sizeof(cjson_member));
-        size++;
         skip_white_space(c);
-        if (*c->json == ',')
+        if (PEEK(c) == ',')
         {
             c->json++;
             skip_white_space(c);
             continue;
         }
-        else if (*c->json == '}')
+        else if (PEEK(c) == '}')
         {
-            cjson_set_object(v, size);
-            memcpy(v->u.o.m, context_pop(c, sizeof(cjson_member) * size), sizeof(cjson_member) * size);
-            v->u.o.size = size;
+            context_close_object(c, v, size);
             c->json++;
             return CJSON_PARSE_OK;
         }
@@ -364,9 +1619,7 @@ int parse_object(context *c, cjson_value *v)
     //cases that failed
     for (size_t i = 0; i < size; i++)
     {
-        cjson_member *m = (cjson_member *)context_pop(c, sizeof(cjson_member));
-        free(m->key);
-        cjson_free(&m->v);
+        member_free((cjson_member *)context_pop(c, sizeof(cjson_member)));
     }
     v->type = CJSON_NULL;
     return ret;
@@ -375,7 +1628,7 @@ int parse_object(context *c, cjson_value *v)
 static int parse_value(context *c, cjson_value *v)
 {
     skip_white_space(c);
-    switch (*c->json)
+    switch (PEEK(c))
     {
     case 't':
         return parse_word(c, v, "true", CJSON_TRUE);
@@ -386,93 +1639,1689 @@ static int parse_value(context *c, cjson_value *v)
     case '\"':
         return parse_string(c, v);
     case '[':
-        return parse_array(c, v);
+        return c->lazy ? parse_lazy(c, v) : parse_array(c, v);
     case '{':
-        return parse_object(c, v);
+        return c->lazy ? parse_lazy(c, v) : parse_object(c, v);
     default:
         return parse_number(c, v);
     }
 }
 
-int cjson_parse(cjson_value *v, const char *json_str)
+static const cjson_sax_handler validate_only; /* no callbacks */
+
+/* validates the whole input first; a valid document ends with its root, so
+ * a root container is recorded without a skip */
+static int parse_lazy_root(context *c, cjson_value *v)
+{
+    int ret = cjson_parse_sax(c->json, c->end - c->json, &validate_only, NULL);
+    if (ret != CJSON_PARSE_OK)
+        return ret;
+    skip_white_space(c);
+    if (PEEK(c) != '[' && PEEK(c) != '{')
+        return parse_value(c, v);
+    const char *stop = c->end;
+    while (ISWHITESPACE(stop[-1]))
+        stop--;
+    lazy_record(v, c->json, stop);
+    c->json = c->end;
+    return CJSON_PARSE_OK;
+}
+
+static int parse_json(cjson_value *v, const char *json_str, size_t len, const cjson_parse_options *opts, int insitu)
 {
     assert(v != NULL && json_str != NULL);
     context c;
-    c.json = json_str;
-    c.capacity = CONTEXT_STACK_DEFAULT_CAPACITY;
+    cjson_context *reuse = opts ? opts->context : NULL;
+    c.json = c.base = json_str;
+    c.end = json_str + len;
+    c.capacity = reuse ? reuse->capacity : 0;
     c.top = 0;
-    c.stack = (char *)malloc(c.capacity);
+    c.stack = reuse ? reuse->stack : NULL;
+    c.arena = opts ? opts->arena : NULL;
+    c.keys = opts ? opts->keys : NULL;
+    c.insitu = insitu;
+    c.lazy = opts && (opts->flags & CJSON_PARSE_LAZY);
+    assert(!c.lazy || (c.arena == NULL && c.keys == NULL)); /* lazy nodes are decoded with malloc() */
+    c.project = (opts && opts->projection) ? opts->projection->nodes : NULL;
+    if (c.project && c.project->keep)
+        c.project = NULL;
+    assert(!c.lazy || c.project == NULL);
+    c.skip_unvalidated = opts && (opts->flags & CJSON_PARSE_SKIP_UNVALIDATED);
+    c.index = NULL;
+    c.index_size = c.index_pos = 0;
+    if (opts && (opts->flags & CJSON_PARSE_STRUCTURAL_INDEX) && len <= UINT32_MAX)
+        c.index = build_structural_index(json_str, len, &c.index_size);
+    cjson_init(v);
     int res;
-    if ((res = parse_value(&c, v)) == CJSON_PARSE_OK)
+    if (c.lazy)
+        res = parse_lazy_root(&c, v);
+    else if ((res = parse_value(&c, v)) == CJSON_PARSE_OK)
     {
         skip_white_space(&c);
-        if (*(c.json) != '\0')
+        if (c.json != c.end)
         {
             res = CJSON_ROOT_NOT_SINGULAR;
         }
     }
     assert(c.top == 0);
-    free(c.stack);
+    if (reuse)
+    {
+        reuse->stack = c.stack;
+        reuse->capacity = c.capacity;
+    }
+    else
+        free(c.stack);
+    free((void *)c.index);
     return res;
 }
 
-static void stringify_string(context *c, const char *s, size_t len)
+int cjson_parse(cjson_value *v, const char *json_str)
 {
-    static const char hex_digits[] = {'0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'A', 'B', 'C', 'D', 'E', 'F'};
-    size_t i, size;
-    char *head, *p;
-    assert(s != NULL);
-    p = head = context_push(c, size = len * 6 + 2); /* "\u00xx..." */
-    *p++ = '"';
-    for (i = 0; i < len; i++)
-    {
-        unsigned char ch = (unsigned char)s[i];
-        switch (ch)
-        {
-        case '\"':
-            *p++ = '\\';
-            *p++ = '\"';
-            break;
-        case '\\':
-            *p++ = '\\';
-            *p++ = '\\';
-            break;
-        case '\b':
-            *p++ = '\\';
-            *p++ = 'b';
-            break;
-        case '\f':
-            *p++ = '\\';
-            *p++ = 'f';
+    assert(json_str != NULL);
+    return parse_json(v, json_str, strlen(json_str), NULL, 0);
+}
+
+int cjson_parse_n(cjson_value *v, const char *buf, size_t len)
+{
+    return parse_json(v, buf, len, NULL, 0);
+}
+
+int cjson_parse_ex(cjson_value *v, const char *buf, size_t len, const cjson_parse_options *opts)
+{
+    return parse_json(v, buf, len, opts, 0);
+}
+
+int cjson_parse_arena(cjson_value *v, const char *json_str, cjson_arena *arena)
+{
+    assert(json_str != NULL && arena != NULL);
+    cjson_parse_options opts = {0, NULL, NULL, NULL, NULL};
+    opts.arena = arena;
+    return parse_json(v, json_str, strlen(json_str), &opts, 0);
+}
+
+int cjson_parse_insitu(cjson_value *v, char *buf, size_t len)
+{
+    return parse_json(v, buf, len, NULL, 1);
+}
+
+/* NDJSON: the input is split into lines serially with memchr (vectorized in
+ * common C libraries), then the lines are parsed by a pool of workers that
+ * take NDJSON_BATCH records at a time from a shared cursor. Each record is
+ * written by exactly one worker, so only the cursor needs a lock. */
+#define NDJSON_BATCH 64
+
+#if !defined(CJSON_NO_THREADS) && defined(_WIN32)
+typedef CRITICAL_SECTION ndjson_mutex;
+#define ndjson_mutex_init(m) InitializeCriticalSection(m)
+#define ndjson_mutex_destroy(m) DeleteCriticalSection(m)
+#define ndjson_lock(m) EnterCriticalSection(m)
+#define ndjson_unlock(m) LeaveCriticalSection(m)
+#elif !defined(CJSON_NO_THREADS)
+typedef pthread_mutex_t ndjson_mutex;
+#define ndjson_mutex_init(m) pthread_mutex_init(m, NULL)
+#define ndjson_mutex_destroy(m) pthread_mutex_destroy(m)
+#define ndjson_lock(m) pthread_mutex_lock(m)
+#define ndjson_unlock(m) pthread_mutex_unlock(m)
+#endif
+
+typedef struct ndjson_job
+{
+    const char *buf;
+    cjson_ndjson_record *records;
+    size_t count;
+    size_t next; /* first record not yet taken by a worker */
+#ifndef CJSON_NO_THREADS
+    ndjson_mutex lock;
+#endif
+} ndjson_job;
+
+static void ndjson_work(ndjson_job *job)
+{
+    while (1)
+    {
+#ifndef CJSON_NO_THREADS
+        ndjson_lock(&job->lock);
+#endif
+        size_t i = job->next, end;
+        job->next = (i < job->count) ? i + NDJSON_BATCH : i;
+#ifndef CJSON_NO_THREADS
+        ndjson_unlock(&job->lock);
+#endif
+        if (i >= job->count)
+            return;
+        end = (i + NDJSON_BATCH < job->count) ? i + NDJSON_BATCH : job->count;
+        for (; i < end; i++)
+        {
+            cjson_ndjson_record *r = &job->records[i];
+            if ((r->error = parse_json(&r->v, job->buf + r->offset, r->length, NULL, 0)) != CJSON_PARSE_OK)
+                cjson_free(&r->v);
+        }
+    }
+}
+
+#ifndef CJSON_NO_THREADS
+#ifdef _WIN32
+static DWORD WINAPI ndjson_thread(LPVOID job)
+{
+    ndjson_work((ndjson_job *)job);
+    return 0;
+}
+#else
+static void *ndjson_thread(void *job)
+{
+    ndjson_work((ndjson_job *)job);
+    return NULL;
+}
+#endif
+
+static unsigned ndjson_cpu_count(void)
+{
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (unsigned)info.dwNumberOfProcessors;
+#elif defined(_SC_NPROCESSORS_ONLN)
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (unsigned)n : 1;
+#else
+    return 1;
+#endif
+}
+#endif
+
+size_t cjson_parse_ndjson(const char *buf, size_t len, unsigned threads, cjson_ndjson_record **records)
+{
+    assert((buf != NULL || len == 0) && records != NULL);
+    const char *p = buf, *end = buf + len;
+    size_t count = 0, capacity = 0;
+    cjson_ndjson_record *r = NULL;
+    while (p < end)
+    {
+        const char *nl = (const char *)memchr(p, '\n', end - p), *line_end = nl ? nl : end;
+        const char *stop = line_end;
+        if (stop > p && stop[-1] == '\r')
+            stop--;
+        if (scan_white_space(p, stop) != stop) /* blank lines are not records */
+        {
+            if (count == capacity)
+            {
+                capacity = capacity ? capacity + (capacity >> 1) : 256;
+                r = (cjson_ndjson_record *)realloc(r, capacity * sizeof(cjson_ndjson_record));
+            }
+            r[count].offset = (size_t)(p - buf);
+            r[count].length = (size_t)(stop - p);
+            count++;
+        }
+        p = line_end + 1;
+    }
+
+    ndjson_job job;
+    job.buf = buf;
+    job.records = r;
+    job.count = count;
+    job.next = 0;
+#ifdef CJSON_NO_THREADS
+    (void)threads;
+    ndjson_work(&job);
+#else
+    if (threads == 0)
+        threads = ndjson_cpu_count();
+    if (threads > (count + NDJSON_BATCH - 1) / NDJSON_BATCH)
+        threads = (unsigned)((count + NDJSON_BATCH - 1) / NDJSON_BATCH);
+    ndjson_mutex_init(&job.lock);
+    if (threads <= 1)
+        ndjson_work(&job);
+    else
+    {
+        /* the calling thread is one of the workers */
+        unsigned i, started = 0;
+#ifdef _WIN32
+        HANDLE *workers = (HANDLE *)malloc(sizeof(HANDLE) * (threads - 1));
+        for (i = 0; i < threads - 1; i++)
+            if ((workers[started] = CreateThread(NULL, 0, ndjson_thread, &job, 0, NULL)) != NULL)
+                started++;
+        ndjson_work(&job);
+        for (i = 0; i < started; i++)
+        {
+            WaitForSingleObject(workers[i], INFINITE);
+            CloseHandle(workers[i]);
+        }
+#else
+        pthread_t *workers = (pthread_t *)malloc(sizeof(pthread_t) * (threads - 1));
+        for (i = 0; i < threads - 1; i++)
+            if (pthread_create(&workers[started], NULL, ndjson_thread, &job) == 0)
+                started++;
+        ndjson_work(&job);
+        for (i = 0; i < started; i++)
+            pthread_join(workers[i], NULL);
+#endif
+        free(workers);
+    }
+    ndjson_mutex_destroy(&job.lock);
+#endif
+    *records = r;
+    return count;
+}
+
+void cjson_ndjson_free(cjson_ndjson_record *records, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+        cjson_free(&records[i].v);
+    free(records);
+}
+
+/* The event parser runs the same lexers as the DOM parser but keeps nothing
+ * beyond the recursion and the string currently being decoded. */
+typedef struct sax_context
+{
+    context c;
+    const cjson_sax_handler *h;
+    void *userdata;
+} sax_context;
+
+#define SAX_EMIT(call)                \
+    do                                \
+    {                                 \
+        if (call)                     \
+            return CJSON_SAX_ABORTED; \
+    } while (0)
+
+static int sax_parse_value(sax_context *sc);
+
+/* decodes a string onto the stack and NUL-terminates it for the callback;
+ * the caller pops len + 1 bytes afterwards */
+static int sax_parse_string(sax_context *sc, char **str, size_t *len)
+{
+    int ret;
+    char *s;
+    if ((ret = parse_string_raw(&sc->c, &s, len)) != CJSON_PARSE_OK)
+        return ret;
+    /* the decoded bytes are still above top; reclaim them plus the terminator */
+    *str = (char *)context_push(&sc->c, *len + 1);
+    (*str)[*len] = '\0';
+    return CJSON_PARSE_OK;
+}
+
+static int sax_parse_array(sax_context *sc)
+{
+    context *c = &sc->c;
+    size_t size = 0;
+    int ret;
+    c->json++;
+    if (sc->h->on_start_array)
+        SAX_EMIT(sc->h->on_start_array(sc->userdata));
+    skip_white_space(c);
+    if (PEEK(c) != ']')
+    {
+        while (1)
+        {
+            if ((ret = sax_parse_value(sc)) != CJSON_PARSE_OK)
+                return ret;
+            size++;
+            skip_white_space(c);
+            if (PEEK(c) == ']')
+                break;
+            if (PEEK(c) != ',')
+                return CJSON_MISS_COMMA_OR_SQUARE_BRACKET;
+            c->json++;
+        }
+    }
+    c->json++;
+    if (sc->h->on_end_array)
+        SAX_EMIT(sc->h->on_end_array(sc->userdata, size));
+    return CJSON_PARSE_OK;
+}
+
+static int sax_parse_object(sax_context *sc)
+{
+    context *c = &sc->c;
+    size_t size = 0, len;
+    char *key;
+    int ret, stop;
+    c->json++;
+    if (sc->h->on_start_object)
+        SAX_EMIT(sc->h->on_start_object(sc->userdata));
+    skip_white_space(c);
+    if (PEEK(c) != '}')
+    {
+        while (1)
+        {
+            if (PEEK(c) != '\"')
+                return CJSON_MISS_KEY;
+            if (sc->h->on_key == NULL)
+            {
+                if ((ret = skip_string(c)) != CJSON_PARSE_OK)
+                    return ret;
+            }
+            else
+            {
+                if ((ret = sax_parse_string(sc, &key, &len)) != CJSON_PARSE_OK)
+                    return ret;
+                stop = sc->h->on_key(sc->userdata, key, len);
+                context_pop(c, len + 1);
+                if (stop)
+                    return CJSON_SAX_ABORTED;
+            }
+            skip_white_space(c);
+            if (PEEK(c) != ':')
+                return CJSON_MISS_COLON;
+            c->json++;
+            if ((ret = sax_parse_value(sc)) != CJSON_PARSE_OK)
+                return ret;
+            size++;
+            skip_white_space(c);
+            if (PEEK(c) == '}')
+                break;
+            if (PEEK(c) != ',')
+                return CJSON_MISS_COMMA_OR_CURLY_BRACKET;
+            c->json++;
+            skip_white_space(c);
+        }
+    }
+    c->json++;
+    if (sc->h->on_end_object)
+        SAX_EMIT(sc->h->on_end_object(sc->userdata, size));
+    return CJSON_PARSE_OK;
+}
+
+static int sax_parse_value(sax_context *sc)
+{
+    context *c = &sc->c;
+    const cjson_sax_handler *h = sc->h;
+    cjson_value v;
+    char *str;
+    size_t len;
+    int ret, stop;
+    skip_white_space(c);
+    cjson_init(&v);
+    switch (PEEK(c))
+    {
+    case 't':
+    case 'f':
+        if ((ret = parse_word(c, &v, PEEK(c) == 't' ? "true" : "false", PEEK(c) == 't' ? CJSON_TRUE : CJSON_FALSE)) != CJSON_PARSE_OK)
+            return ret;
+        if (h->on_boolean)
+            SAX_EMIT(h->on_boolean(sc->userdata, v.type == CJSON_TRUE));
+        return CJSON_PARSE_OK;
+    case 'n':
+        if ((ret = parse_word(c, &v, "null", CJSON_NULL)) != CJSON_PARSE_OK)
+            return ret;
+        if (h->on_null)
+            SAX_EMIT(h->on_null(sc->userdata));
+        return CJSON_PARSE_OK;
+    case '\"':
+        if (h->on_string == NULL)
+            return skip_string(c);
+        if ((ret = sax_parse_string(sc, &str, &len)) != CJSON_PARSE_OK)
+            return ret;
+        stop = h->on_string(sc->userdata, str, len);
+        context_pop(c, len + 1);
+        return stop ? CJSON_SAX_ABORTED : CJSON_PARSE_OK;
+    case '[':
+        return sax_parse_array(sc);
+    case '{':
+        return sax_parse_object(sc);
+    default:
+        if ((ret = parse_number(c, &v)) != CJSON_PARSE_OK)
+            return ret;
+        if (h->on_number)
+            SAX_EMIT(h->on_number(sc->userdata, &v));
+        return CJSON_PARSE_OK;
+    }
+}
+
+int cjson_parse_sax(const char *buf, size_t len, const cjson_sax_handler *handler, void *userdata)
+{
+    assert(buf != NULL && handler != NULL);
+    sax_context sc;
+    context *c = &sc.c;
+    memset(c, 0, sizeof(context));
+    c->json = c->base = buf;
+    c->end = buf + len;
+    c->capacity = CONTEXT_STACK_DEFAULT_CAPACITY;
+    c->stack = (char *)malloc(c->capacity);
+    sc.h = handler;
+    sc.userdata = userdata;
+    int res;
+    if ((res = sax_parse_value(&sc)) == CJSON_PARSE_OK)
+    {
+        skip_white_space(c);
+        if (c->json != c->end)
+            res = CJSON_ROOT_NOT_SINGULAR;
+    }
+    assert(c->top == 0);
+    free(c->stack);
+    return res;
+}
+
+/* Steps over the value at c->json without building anything. Unless
+ * CJSON_PARSE_SKIP_UNVALIDATED is set, the value is checked by the event
+ * parser, so errors match cjson_parse(). Otherwise containers are matched
+ * with skip_validated_container(), strings run to the next unescaped quote,
+ * and any other token runs to the next delimiter. */
+static int skip_value(context *c)
+{
+    const char *p, *end = c->end;
+    skip_white_space(c);
+    if (!c->skip_unvalidated)
+    {
+        sax_context sc;
+        sc.c = *c;
+        sc.h = &validate_only;
+        sc.userdata = NULL;
+        int ret = sax_parse_value(&sc);
+        *c = sc.c;
+        return ret;
+    }
+    switch (PEEK(c))
+    {
+    case '[':
+    case '{':
+        if ((p = skip_validated_container(c->json, end)) == NULL)
+            return PEEK(c) == '[' ? CJSON_MISS_COMMA_OR_SQUARE_BRACKET : CJSON_MISS_COMMA_OR_CURLY_BRACKET;
+        break;
+    case '\"':
+        for (p = c->json + 1;; p++)
+        {
+            if ((p = scan_string(p, end)) == end)
+                return CJSON_INVALID_STRING_MISS_QUOTATION;
+            if (*p == '\"')
+                break;
+            if (*p == '\\' && ++p == end)
+                return CJSON_INVALID_STRING_MISS_QUOTATION;
+        }
+        p++;
+        break;
+    case '\0':
+        return CJSON_EXPECT_VALUE;
+    default:
+        for (p = c->json; p < end && *p != ',' && *p != ']' && *p != '}' && !ISWHITESPACE(*p); p++)
+            ;
+        if (p == c->json)
+            return CJSON_INVALID_VALUE;
+        break;
+    }
+    c->json = p;
+    return CJSON_PARSE_OK;
+}
+
+/* Push parser. The recursive descent above needs the whole document, so the
+ * grammar is replayed here as an explicit state machine with one frame per
+ * open container. Elements and members wait on the context stack exactly as
+ * in parse_array()/parse_object(). A string, number or literal cut off by the
+ * end of a chunk is copied to pend and lexed once its end has arrived. */
+enum
+{
+    PUSH_VALUE,          /* a value */
+    PUSH_VALUE_OR_CLOSE, /* a value or ']' right after '[' */
+    PUSH_KEY,            /* a key after ',' in an object */
+    PUSH_KEY_OR_CLOSE,   /* a key or '}' right after '{' */
+    PUSH_COLON,
+    PUSH_COMMA_OR_CLOSE,
+    PUSH_DONE /* root value complete, only whitespace may follow */
+};
+
+typedef struct push_frame
+{
+    size_t size; /* completed elements or members */
+    int object;
+} push_frame;
+
+struct cjson_parser
+{
+    context c;
+    push_frame *frames;
+    size_t depth, frames_capacity;
+    int state;
+    int status; /* CJSON_PARSE_NEED_MORE, CJSON_PARSE_OK or a sticky error */
+    cjson_value root;
+    char *pend; /* partial token carried over from earlier chunks */
+    size_t pend_len, pend_capacity;
+    int pend_active, pend_string, pend_escape;
+};
+
+/* end of the string whose body starts at p, or NULL if it runs past end */
+static const char *string_token_end(const char *p, const char *end, int *escape)
+{
+    if (*escape)
+    {
+        if (p == end)
+            return NULL;
+        p++;
+        *escape = 0;
+    }
+    while ((p = scan_string(p, end)) != end)
+    {
+        if (*p == '\"')
+            return p + 1;
+        if (*p == '\\' && ++p == end)
+        {
+            *escape = 1;
+            return NULL;
+        }
+        p++; /* escaped or control character, reported by the lexer later */
+    }
+    return NULL;
+}
+
+/* end of the number or literal at p, or NULL if it runs up to end */
+static const char *word_token_end(const char *p, const char *end)
+{
+    for (; p != end; p++)
+    {
+        char ch = *p;
+        if (!(ISDIGIT(ch) || (ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z') || ch == '+' || ch == '-' || ch == '.'))
+            return p;
+    }
+    return NULL;
+}
+
+static void push_pend(cjson_parser *p, const char *s, size_t len)
+{
+    if (p->pend_len + len > p->pend_capacity)
+    {
+        while (p->pend_len + len > p->pend_capacity)
+            p->pend_capacity += p->pend_capacity >> 1;
+        p->pend = (char *)realloc(p->pend, p->pend_capacity);
+    }
+    memcpy(p->pend + p->pend_len, s, len);
+    p->pend_len += len;
+}
+
+static void push_emit(cjson_parser *p, cjson_value *v)
+{
+    context *c = &p->c;
+    if (p->depth == 0)
+    {
+        p->root = *v;
+        p->state = PUSH_DONE;
+        return;
+    }
+    push_frame *f = &p->frames[p->depth - 1];
+    if (f->object)
+    {
+        /* the member was pushed when its key was read */
+        cjson_member *m = (cjson_member *)(c->stack + c->top - sizeof(cjson_member));
+        unsigned key_flags = m->v.flags & FLAG_KEY_MASK;
+        m->v = *v;
+        m->v.flags |= key_flags;
+    }
+    else
+        memcpy(context_push(c, sizeof(cjson_value)), v, sizeof(cjson_value));
+    f->size++;
+    p->state = PUSH_COMMA_OR_CLOSE;
+}
+
+/* lexes the complete key or scalar token at c->json */
+static int push_lex(cjson_parser *p)
+{
+    context *c = &p->c;
+    cjson_value v;
+    int ret;
+    cjson_init(&v);
+    if (p->state == PUSH_KEY || p->state == PUSH_KEY_OR_CLOSE)
+    {
+        cjson_member m;
+        char *key;
+        size_t klen;
+        if ((ret = parse_string_raw(c, &key, &klen)) != CJSON_PARSE_OK)
+            return ret;
+        cjson_init(&m.v);
+        m.v.flags |= context_set_key(c, &m, key, klen);
+        memcpy(context_push(c, sizeof(cjson_member)), &m, sizeof(cjson_member));
+        p->state = PUSH_COLON;
+        return CJSON_PARSE_OK;
+    }
+    if ((ret = parse_value(c, &v)) != CJSON_PARSE_OK)
+        return ret;
+    push_emit(p, &v);
+    return CJSON_PARSE_OK;
+}
+
+/* lexes the token at c->json, or moves it to pend if the chunk cuts it off */
+static int push_token(cjson_parser *p, int final)
+{
+    context *c = &p->c;
+    int string = PEEK(c) == '\"';
+    p->pend_escape = 0;
+    if (final || (string ? string_token_end(c->json + 1, c->end, &p->pend_escape) : word_token_end(c->json, c->end)))
+        return push_lex(p);
+    p->pend_len = 0;
+    push_pend(p, c->json, c->end - c->json);
+    p->pend_active = 1;
+    p->pend_string = string;
+    c->json = c->end;
+    return CJSON_PARSE_NEED_MORE;
+}
+
+/* completes the token in pend with the start of the current chunk */
+static int push_resume(cjson_parser *p, int final)
+{
+    context *c = &p->c;
+    const char *json = c->json, *end = c->end;
+    const char *stop = p->pend_string ? string_token_end(json, end, &p->pend_escape) : word_token_end(json, end);
+    int ret;
+    if (stop == NULL && !final)
+    {
+        push_pend(p, json, end - json);
+        c->json = end;
+        return CJSON_PARSE_NEED_MORE;
+    }
+    if (stop == NULL)
+        stop = end;
+    push_pend(p, json, stop - json);
+    p->pend_active = 0;
+    c->json = p->pend;
+    c->end = p->pend + p->pend_len;
+    ret = push_lex(p);
+    if (ret == CJSON_PARSE_OK && c->json != c->end)
+    {
+        /* the rest of a word token, e.g. "1.5.3", is what the grammar sees next */
+        if (p->state == PUSH_DONE)
+            ret = CJSON_ROOT_NOT_SINGULAR;
+        else
+            ret = p->frames[p->depth - 1].object ? CJSON_MISS_COMMA_OR_CURLY_BRACKET : CJSON_MISS_COMMA_OR_SQUARE_BRACKET;
+    }
+    c->json = stop;
+    c->end = end;
+    return ret;
+}
+
+static void push_close(cjson_parser *p)
+{
+    context *c = &p->c;
+    push_frame *f = &p->frames[--p->depth];
+    cjson_value v;
+    c->json++;
+    if (f->object)
+        context_close_object(c, &v, f->size);
+    else
+        context_close_array(c, &v, f->size);
+    push_emit(p, &v);
+}
+
+static int push_run(cjson_parser *p, int final)
+{
+    context *c = &p->c;
+    int ret;
+    while (1)
+    {
+        skip_white_space(c);
+        if (c->json == c->end && !final)
+            return p->state == PUSH_DONE ? CJSON_PARSE_OK : CJSON_PARSE_NEED_MORE;
+        char ch = PEEK(c);
+        switch (p->state)
+        {
+        case PUSH_DONE:
+            return c->json == c->end ? CJSON_PARSE_OK : CJSON_ROOT_NOT_SINGULAR;
+        case PUSH_VALUE_OR_CLOSE:
+            if (ch == ']')
+            {
+                push_close(p);
+                break;
+            }
+            /* fall through */
+        case PUSH_VALUE:
+            if (ch == '[' || ch == '{')
+            {
+                if (p->depth == p->frames_capacity)
+                {
+                    p->frames_capacity += p->frames_capacity >> 1;
+                    p->frames = (push_frame *)realloc(p->frames, p->frames_capacity * sizeof(push_frame));
+                }
+                p->frames[p->depth].size = 0;
+                p->frames[p->depth++].object = ch == '{';
+                p->state = ch == '{' ? PUSH_KEY_OR_CLOSE : PUSH_VALUE_OR_CLOSE;
+                c->json++;
+            }
+            else if ((ret = push_token(p, final)) != CJSON_PARSE_OK)
+                return ret;
             break;
-        case '\n':
-            *p++ = '\\';
-            *p++ = 'n';
+        case PUSH_KEY_OR_CLOSE:
+            if (ch == '}')
+            {
+                push_close(p);
+                break;
+            }
+            /* fall through */
+        case PUSH_KEY:
+            if (ch != '\"')
+                return CJSON_MISS_KEY;
+            if ((ret = push_token(p, final)) != CJSON_PARSE_OK)
+                return ret;
+            break;
+        case PUSH_COLON:
+            if (ch != ':')
+                return CJSON_MISS_COLON;
+            c->json++;
+            p->state = PUSH_VALUE;
+            break;
+        case PUSH_COMMA_OR_CLOSE:
+            if (ch == ',')
+            {
+                c->json++;
+                p->state = p->frames[p->depth - 1].object ? PUSH_KEY : PUSH_VALUE;
+            }
+            else if (ch == (p->frames[p->depth - 1].object ? '}' : ']'))
+                push_close(p);
+            else
+                return p->frames[p->depth - 1].object ? CJSON_MISS_COMMA_OR_CURLY_BRACKET : CJSON_MISS_COMMA_OR_SQUARE_BRACKET;
+            break;
+        }
+    }
+}
+
+/* frees everything parsed so far and gets ready for a new document */
+static void push_reset(cjson_parser *p)
+{
+    context *c = &p->c;
+    int pending_key = p->state == PUSH_COLON || p->state == PUSH_VALUE;
+    while (p->depth > 0)
+    {
+        push_frame *f = &p->frames[--p->depth];
+        if (f->object)
+        {
+            /* every open object but the innermost is waiting for a value */
+            for (size_t i = f->size + (size_t)pending_key; i > 0; i--)
+                member_free((cjson_member *)context_pop(c, sizeof(cjson_member)));
+        }
+        else
+        {
+            for (size_t i = f->size; i > 0; i--)
+                cjson_free((cjson_value *)context_pop(c, sizeof(cjson_value)));
+        }
+        pending_key = 1;
+    }
+    assert(c->top == 0);
+    cjson_free(&p->root);
+    p->state = PUSH_VALUE;
+    p->status = CJSON_PARSE_NEED_MORE;
+    p->pend_active = 0;
+}
+
+static int push_feed(cjson_parser *p, const char *chunk, size_t len, int final)
+{
+    context *c = &p->c;
+    int ret = CJSON_PARSE_OK;
+    if (p->status != CJSON_PARSE_NEED_MORE && p->status != CJSON_PARSE_OK)
+        return p->status;
+    c->json = c->base = chunk;
+    c->end = chunk + len;
+    if (p->pend_active)
+        ret = push_resume(p, final);
+    if (ret == CJSON_PARSE_OK)
+        ret = push_run(p, final);
+    return p->status = ret;
+}
+
+cjson_parser *cjson_parser_new(const cjson_parse_options *opts)
+{
+    cjson_parser *p = (cjson_parser *)malloc(sizeof(cjson_parser));
+    memset(&p->c, 0, sizeof(context));
+    p->c.capacity = CONTEXT_STACK_DEFAULT_CAPACITY;
+    p->c.stack = (char *)malloc(p->c.capacity);
+    p->c.arena = opts ? opts->arena : NULL;
+    p->c.keys = opts ? opts->keys : NULL;
+    assert(opts == NULL || opts->projection == NULL);
+    p->frames_capacity = 16;
+    p->frames = (push_frame *)malloc(p->frames_capacity * sizeof(push_frame));
+    p->depth = 0;
+    p->pend_capacity = 64;
+    p->pend = (char *)malloc(p->pend_capacity);
+    p->pend_len = 0;
+    cjson_init(&p->root);
+    push_reset(p);
+    return p;
+}
+
+int cjson_parser_feed(cjson_parser *p, const char *chunk, size_t len)
+{
+    assert(p != NULL && (chunk != NULL || len == 0));
+    return push_feed(p, chunk, len, 0);
+}
+
+int cjson_parser_finish(cjson_parser *p, cjson_value *v)
+{
+    assert(p != NULL && v != NULL);
+    int ret = push_feed(p, "", 0, 1);
+    cjson_init(v);
+    if (ret == CJSON_PARSE_OK)
+    {
+        *v = p->root;
+        cjson_init(&p->root);
+    }
+    push_reset(p);
+    return ret;
+}
+
+void cjson_parser_free(cjson_parser *p)
+{
+    if (p == NULL)
+        return;
+    push_reset(p);
+    free(p->c.stack);
+    free(p->frames);
+    free(p->pend);
+    free(p);
+}
+
+static void stringify_flush(context *c)
+{
+    if (c->top > 0 && c->write_status == 0)
+        c->write_status = c->write(c->userdata, c->stack, c->top);
+    c->top = 0;
+}
+
+/* with a sink the buffer is flushed instead of grown, so size must fit in it */
+static char *stringify_sink_push(context *c, size_t size)
+{
+    if (c->top + size > c->capacity)
+        stringify_flush(c);
+    assert(size <= c->capacity);
+    char *ret = c->stack + c->top;
+    c->top += size;
+    return ret;
+}
+
+/* output space for the stringifier */
+#define STRINGIFY_PUSH(c, size) ((c)->write ? stringify_sink_push(c, size) : (char *)context_push(c, size))
+#define OUTC(c, ch)                    \
+    do                                 \
+    {                                  \
+        *STRINGIFY_PUSH(c, 1) = (ch); \
+    } while (0)
+
+/* short runs are not worth the indirect call */
+static const char *scan_escape(const char *s, const char *end)
+{
+    return end - s < 16 ? scan_string_scalar(s, end) : scan_string(s, end);
+}
+
+/* writes the escape for a byte scan_escape() stopped at; at most 6 bytes */
+static char *stringify_escape(char *p, unsigned char ch)
+{
+    static const char hex_digits[] = {'0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'A', 'B', 'C', 'D', 'E', 'F'};
+    *p++ = '\\';
+    switch (ch)
+    {
+    case '\"':
+        *p++ = '\"';
+        break;
+    case '\\':
+        *p++ = '\\';
+        break;
+    case '\b':
+        *p++ = 'b';
+        break;
+    case '\f':
+        *p++ = 'f';
+        break;
+    case '\n':
+        *p++ = 'n';
+        break;
+    case '\r':
+        *p++ = 'r';
+        break;
+    case '\t':
+        *p++ = 't';
+        break;
+    default:
+        *p++ = 'u';
+        *p++ = '0';
+        *p++ = '0';
+        *p++ = hex_digits[ch >> 4];
+        *p++ = hex_digits[ch & 15];
+    }
+    return p;
+}
+
+/* Runs that need no escaping are found with scan_escape() and copied with
+ * memcpy(). Without a sink the string reserves its unescaped length and
+ * grows only when an escape needs more; top always covers the rest of the
+ * string plus the closing quote. Short strings take one worst-case
+ * reservation and a byte loop instead. With a sink, runs are copied in
+ * pieces that fit the buffer. */
+static void stringify_string(context *c, const char *s, size_t len)
+{
+    const char *end = s + len, *run;
+    size_t pos, n;
+    char *p, *head;
+    assert(s != NULL || len == 0); /* empty parsed strings have no buffer */
+    if (c->write == NULL && len < 16)
+    {
+        p = head = context_push(c, n = len * 6 + 2);
+        *p++ = '"';
+        for (; s < end; s++)
+        {
+            if ((unsigned char)*s < 0x20 || *s == '"' || *s == '\\')
+                p = stringify_escape(p, (unsigned char)*s);
+            else
+                *p++ = *s;
+        }
+        *p++ = '"';
+        c->top -= n - (p - head);
+        return;
+    }
+    if (c->write == NULL)
+    {
+        pos = c->top;
+        p = context_push(c, len + 2);
+        *p = '"';
+        pos++;
+        while ((run = scan_escape(s, end)) != end)
+        {
+            memcpy(c->stack + pos, s, run - s);
+            pos += run - s;
+            if (pos + 6 + (end - run) > c->top)
+                context_push(c, pos + 6 + (end - run) - c->top);
+            pos = stringify_escape(c->stack + pos, (unsigned char)*run) - c->stack;
+            s = run + 1;
+        }
+        if (s != end)
+            memcpy(c->stack + pos, s, end - s);
+        pos += end - s;
+        c->stack[pos++] = '"';
+        c->top = pos;
+        return;
+    }
+    OUTC(c, '"');
+    for (;;)
+    {
+        run = scan_escape(s, end);
+        while (s < run)
+        {
+            if (c->top == c->capacity)
+                stringify_flush(c);
+            n = c->capacity - c->top;
+            if (n > (size_t)(run - s))
+                n = run - s;
+            memcpy(c->stack + c->top, s, n);
+            c->top += n;
+            s += n;
+        }
+        if (run == end)
+            break;
+        p = stringify_sink_push(c, 6);
+        c->top -= 6 - (stringify_escape(p, (unsigned char)*run) - p);
+        s = run + 1;
+    }
+    OUTC(c, '"');
+}
+
+static const char digit_pairs[201] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+/* writes the decimal digits of u two at a time; returns the end of the output */
+static char *format_uint64(char *buf, uint64_t u)
+{
+    char tmp[20], *p = tmp + sizeof(tmp);
+    size_t len;
+    while (u >= 100)
+    {
+        unsigned pair = (unsigned)(u % 100) * 2;
+        u /= 100;
+        *--p = digit_pairs[pair + 1];
+        *--p = digit_pairs[pair];
+    }
+    if (u >= 10)
+    {
+        *--p = digit_pairs[u * 2 + 1];
+        *--p = digit_pairs[u * 2];
+    }
+    else
+        *--p = (char)('0' + u);
+    len = tmp + sizeof(tmp) - p;
+    memcpy(buf, p, len);
+    return buf + len;
+}
+
+static char *format_int64(char *buf, int64_t i)
+{
+    if (i < 0)
+    {
+        *buf++ = '-';
+        return format_uint64(buf, 0 - (uint64_t)i);
+    }
+    return format_uint64(buf, (uint64_t)i);
+}
+
+/* Grisu3 (Loitsch, "Printing Floating-Point Numbers Quickly and Accurately
+ * with Integers", as in double-conversion). It uses integer arithmetic only,
+ * so the digits are the same on every platform. It either finds the shortest
+ * digits that round-trip, closest to the value, or reports that its error
+ * bounds cannot tell; that happens for about 0.5% of doubles, which then go
+ * to the exact bignum_dtoa(). */
+typedef struct diy_fp
+{
+    uint64_t f;
+    int e;
+} diy_fp;
+
+#define DP_SIGNIFICAND_SIZE 52
+#define DP_EXPONENT_BIAS (0x3FF + DP_SIGNIFICAND_SIZE)
+#define DP_HIDDEN_BIT (UINT64_C(1) << DP_SIGNIFICAND_SIZE)
+#define DP_SIGNIFICAND_MASK (DP_HIDDEN_BIT - 1)
+
+/* normalized 10^k for k = -348, -340, ..., 340 */
+static const uint64_t cached_powers_f[] = {
+    UINT64_C(0xfa8fd5a0081c0288), UINT64_C(0xbaaee17fa23ebf76), UINT64_C(0x8b16fb203055ac76),
+    UINT64_C(0xcf42894a5dce35ea), UINT64_C(0x9a6bb0aa55653b2d), UINT64_C(0xe61acf033d1a45df),
+    UINT64_C(0xab70fe17c79ac6ca), UINT64_C(0xff77b1fcbebcdc4f), UINT64_C(0xbe5691ef416bd60c),
+    UINT64_C(0x8dd01fad907ffc3c), UINT64_C(0xd3515c2831559a83), UINT64_C(0x9d71ac8fada6c9b5),
+    UINT64_C(0xea9c227723ee8bcb), UINT64_C(0xaecc49914078536d), UINT64_C(0x823c12795db6ce57),
+    UINT64_C(0xc21094364dfb5637), UINT64_C(0x9096ea6f3848984f), UINT64_C(0xd77485cb25823ac7),
+    UINT64_C(0xa086cfcd97bf97f4), UINT64_C(0xef340a98172aace5), UINT64_C(0xb23867fb2a35b28e),
+    UINT64_C(0x84c8d4dfd2c63f3b), UINT64_C(0xc5dd44271ad3cdba), UINT64_C(0x936b9fcebb25c996),
+    UINT64_C(0xdbac6c247d62a584), UINT64_C(0xa3ab66580d5fdaf6), UINT64_C(0xf3e2f893dec3f126),
+    UINT64_C(0xb5b5ada8aaff80b8), UINT64_C(0x87625f056c7c4a8b), UINT64_C(0xc9bcff6034c13053),
+    UINT64_C(0x964e858c91ba2655), UINT64_C(0xdff9772470297ebd), UINT64_C(0xa6dfbd9fb8e5b88f),
+    UINT64_C(0xf8a95fcf88747d94), UINT64_C(0xb94470938fa89bcf), UINT64_C(0x8a08f0f8bf0f156b),
+    UINT64_C(0xcdb02555653131b6), UINT64_C(0x993fe2c6d07b7fac), UINT64_C(0xe45c10c42a2b3b06),
+    UINT64_C(0xaa242499697392d3), UINT64_C(0xfd87b5f28300ca0e), UINT64_C(0xbce5086492111aeb),
+    UINT64_C(0x8cbccc096f5088cc), UINT64_C(0xd1b71758e219652c), UINT64_C(0x9c40000000000000),
+    UINT64_C(0xe8d4a51000000000), UINT64_C(0xad78ebc5ac620000), UINT64_C(0x813f3978f8940984),
+    UINT64_C(0xc097ce7bc90715b3), UINT64_C(0x8f7e32ce7bea5c70), UINT64_C(0xd5d238a4abe98068),
+    UINT64_C(0x9f4f2726179a2245), UINT64_C(0xed63a231d4c4fb27), UINT64_C(0xb0de65388cc8ada8),
+    UINT64_C(0x83c7088e1aab65db), UINT64_C(0xc45d1df942711d9a), UINT64_C(0x924d692ca61be758),
+    UINT64_C(0xda01ee641a708dea), UINT64_C(0xa26da3999aef774a), UINT64_C(0xf209787bb47d6b85),
+    UINT64_C(0xb454e4a179dd1877), UINT64_C(0x865b86925b9bc5c2), UINT64_C(0xc83553c5c8965d3d),
+    UINT64_C(0x952ab45cfa97a0b3), UINT64_C(0xde469fbd99a05fe3), UINT64_C(0xa59bc234db398c25),
+    UINT64_C(0xf6c69a72a3989f5c), UINT64_C(0xb7dcbf5354e9bece), UINT64_C(0x88fcf317f22241e2),
+    UINT64_C(0xcc20ce9bd35c78a5), UINT64_C(0x98165af37b2153df), UINT64_C(0xe2a0b5dc971f303a),
+    UINT64_C(0xa8d9d1535ce3b396), UINT64_C(0xfb9b7cd9a4a7443c), UINT64_C(0xbb764c4ca7a44410),
+    UINT64_C(0x8bab8eefb6409c1a), UINT64_C(0xd01fef10a657842c), UINT64_C(0x9b10a4e5e9913129),
+    UINT64_C(0xe7109bfba19c0c9d), UINT64_C(0xac2820d9623bf429), UINT64_C(0x80444b5e7aa7cf85),
+    UINT64_C(0xbf21e44003acdd2d), UINT64_C(0x8e679c2f5e44ff8f), UINT64_C(0xd433179d9c8cb841),
+    UINT64_C(0x9e19db92b4e31ba9), UINT64_C(0xeb96bf6ebadf77d9), UINT64_C(0xaf87023b9bf0ee6b)};
+static const int16_t cached_powers_e[] = {
+    -1220, -1193, -1166, -1140, -1113, -1087, -1060, -1034, -1007, -980, -954, -927,
+    -901, -874, -847, -821, -794, -768, -741, -715, -688, -661, -635, -608,
+    -582, -555, -529, -502, -475, -449, -422, -396, -369, -343, -316, -289,
+    -263, -236, -210, -183, -157, -130, -103, -77, -50, -24, 3, 30,
+    56, 83, 109, 136, 162, 189, 216, 242, 269, 295, 322, 348,
+    375, 402, 428, 455, 481, 508, 534, 561, 588, 614, 641, 667,
+    694, 720, 747, 774, 800, 827, 853, 880, 907, 933, 960, 986,
+    1013, 1039, 1066};
+
+static const uint64_t pow10_u64[20] = {
+    UINT64_C(1), UINT64_C(10), UINT64_C(100), UINT64_C(1000), UINT64_C(10000), UINT64_C(100000),
+    UINT64_C(1000000), UINT64_C(10000000), UINT64_C(100000000), UINT64_C(1000000000),
+    UINT64_C(10000000000), UINT64_C(100000000000), UINT64_C(1000000000000), UINT64_C(10000000000000),
+    UINT64_C(100000000000000), UINT64_C(1000000000000000), UINT64_C(10000000000000000),
+    UINT64_C(100000000000000000), UINT64_C(1000000000000000000), UINT64_C(10000000000000000000)};
+
+static diy_fp diy_fp_multiply(diy_fp x, diy_fp y)
+{
+    const uint64_t m32 = 0xFFFFFFFFu;
+    uint64_t a = x.f >> 32, b = x.f & m32, c = y.f >> 32, d = y.f & m32;
+    uint64_t ac = a * c, bc = b * c, ad = a * d, bd = b * d;
+    uint64_t tmp = (bd >> 32) + (ad & m32) + (bc & m32) + (UINT64_C(1) << 31); /* round */
+    diy_fp r;
+    r.f = ac + (ad >> 32) + (bc >> 32) + (tmp >> 32);
+    r.e = x.e + y.e + 64;
+    return r;
+}
+
+/* Moves the last digit down while that brings it closer to w, then checks
+ * that the result is closest to w and inside the interval whatever the
+ * errors of the scaled values, each at most unit. Distances are from
+ * too_high, the top of the widened interval; 0 means not proven. */
+static int grisu_round_weed(char *digits, int len, uint64_t too_high_w, uint64_t unsafe, uint64_t rest,
+                            uint64_t ten_kappa, uint64_t unit)
+{
+    uint64_t small = too_high_w - unit, big = too_high_w + unit;
+    while (rest < small && unsafe - rest >= ten_kappa &&
+           (rest + ten_kappa < small || small - rest >= rest + ten_kappa - small))
+    {
+        digits[len - 1]--;
+        rest += ten_kappa;
+    }
+    if (rest < big && unsafe - rest >= ten_kappa && (rest + ten_kappa < big || big - rest > rest + ten_kappa - big))
+        return 0;
+    return (2 * unit <= rest && rest <= unsafe - 4 * unit) ? len : 0;
+}
+
+/* digits of the shortest number in (low, high), widened by the error bound,
+ * all three with the same exponent in [-60, -32]; returns 0 if not proven */
+static int grisu_digit_gen(diy_fp low, diy_fp w, diy_fp high, char *digits, int *K)
+{
+    uint64_t unit = 1, too_high = high.f + unit, unsafe = too_high - (low.f - unit);
+    const int shift = -w.e;
+    const uint64_t one = UINT64_C(1) << shift, mask = one - 1;
+    uint32_t p1 = (uint32_t)(too_high >> shift);
+    uint64_t p2 = too_high & mask;
+    int kappa = 1, len = 0;
+    while (kappa < 10 && p1 >= pow10_u64[kappa])
+        kappa++;
+    while (kappa > 0)
+    {
+        digits[len++] = (char)('0' + p1 / (uint32_t)pow10_u64[kappa - 1]);
+        p1 %= (uint32_t)pow10_u64[kappa - 1];
+        kappa--;
+        uint64_t rest = ((uint64_t)p1 << shift) + p2;
+        if (rest < unsafe)
+        {
+            *K += kappa;
+            return grisu_round_weed(digits, len, too_high - w.f, unsafe, rest, pow10_u64[kappa] << shift, unit);
+        }
+    }
+    for (;;)
+    {
+        p2 *= 10;
+        unit *= 10;
+        unsafe *= 10;
+        digits[len++] = (char)('0' + (p2 >> shift));
+        p2 &= mask;
+        kappa--;
+        if (p2 < unsafe)
+        {
+            *K += kappa;
+            return grisu_round_weed(digits, len, (too_high - w.f) * unit, unsafe, p2, one, unit);
+        }
+    }
+}
+
+/* significand and exponent of a positive finite value = f * 2^e */
+static uint64_t double_decompose(double value, int *e)
+{
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    int biased_e = (int)((bits >> DP_SIGNIFICAND_SIZE) & 0x7FF);
+    *e = biased_e ? biased_e - DP_EXPONENT_BIAS : 1 - DP_EXPONENT_BIAS;
+    return biased_e ? (bits & DP_SIGNIFICAND_MASK) + DP_HIDDEN_BIT : bits & DP_SIGNIFICAND_MASK;
+}
+
+/* digits of a positive finite value v = digits * 10^K; returns the digit
+ * count, or 0 if the shortest digits could not be proven */
+static int grisu3(double value, char *digits, int *K)
+{
+    diy_fp v, plus, minus, c_mk;
+    v.f = double_decompose(value, &v.e);
+    /* boundaries of the rounding interval, both with the exponent of m+ */
+    plus.f = (v.f << 1) + 1;
+    plus.e = v.e - 1;
+    while (!(plus.f & (DP_HIDDEN_BIT << 1)))
+    {
+        plus.f <<= 1;
+        plus.e--;
+    }
+    plus.f <<= 64 - DP_SIGNIFICAND_SIZE - 2;
+    plus.e -= 64 - DP_SIGNIFICAND_SIZE - 2;
+    int lower_closer = v.f == DP_HIDDEN_BIT && v.e > 1 - DP_EXPONENT_BIAS;
+    minus.f = lower_closer ? (v.f << 2) - 1 : (v.f << 1) - 1;
+    minus.e = lower_closer ? v.e - 2 : v.e - 1;
+    minus.f <<= minus.e - plus.e;
+    minus.e = plus.e;
+    while (!(v.f & (UINT64_C(1) << 63)))
+    {
+        v.f <<= 1;
+        v.e--;
+    }
+    /* cached 10^-K that brings the product exponent into [-60, -32] */
+    double dk = (-61 - plus.e) * 0.30102999566398114 + 347;
+    int k = (int)dk;
+    if (dk - k > 0.0)
+        k++;
+    unsigned index = (unsigned)((k >> 3) + 1);
+    *K = -(-348 + (int)(index << 3));
+    c_mk.f = cached_powers_f[index];
+    c_mk.e = cached_powers_e[index];
+    diy_fp w = diy_fp_multiply(v, c_mk), wp = diy_fp_multiply(plus, c_mk), wm = diy_fp_multiply(minus, c_mk);
+    return grisu_digit_gen(wm, w, wp, digits, K);
+}
+
+/* Exact fallback: free-format digit generation (Steele and White, Burger
+ * and Dybvig) on big integers. The value and its boundaries are scaled to
+ * r/s, m+/s and m-/s so that each digit is a quotient of r by s. The
+ * boundaries belong to the interval when the significand is even, because
+ * the parser rounds ties to even. */
+#define BIGNUM_LIMBS 128 /* 4096 bits, for number_slow_path(); format_double() stays below 2^1090 */
+
+typedef struct bignum
+{
+    uint32_t d[BIGNUM_LIMBS];
+    int n; /* limbs in use, without leading zeros */
+} bignum;
+
+static void bignum_set(bignum *b, uint64_t x)
+{
+    b->n = 0;
+    for (; x; x >>= 32)
+        b->d[b->n++] = (uint32_t)x;
+}
+
+static void bignum_mul(bignum *b, uint32_t m)
+{
+    uint64_t carry = 0;
+    for (int i = 0; i < b->n; i++)
+    {
+        carry += (uint64_t)b->d[i] * m;
+        b->d[i] = (uint32_t)carry;
+        carry >>= 32;
+    }
+    if (carry)
+        b->d[b->n++] = (uint32_t)carry;
+}
+
+static void bignum_add_small(bignum *b, uint32_t x)
+{
+    uint64_t carry = x;
+    for (int i = 0; carry && i < b->n; i++)
+    {
+        carry += b->d[i];
+        b->d[i] = (uint32_t)carry;
+        carry >>= 32;
+    }
+    if (carry)
+        b->d[b->n++] = (uint32_t)carry;
+}
+
+static void bignum_mul_pow10(bignum *b, int k)
+{
+    for (; k >= 9; k -= 9)
+        bignum_mul(b, 1000000000u);
+    if (k > 0)
+        bignum_mul(b, (uint32_t)pow10_u64[k]);
+}
+
+static void bignum_shl(bignum *b, int bits)
+{
+    int words = bits / 32, shift = bits % 32;
+    if (b->n == 0)
+        return;
+    if (shift)
+    {
+        b->d[b->n] = 0;
+        for (int i = b->n; i > 0; i--)
+            b->d[i] = (b->d[i] << shift) | (b->d[i - 1] >> (32 - shift));
+        b->d[0] <<= shift;
+        if (b->d[b->n])
+            b->n++;
+    }
+    memmove(b->d + words, b->d, sizeof(uint32_t) * b->n);
+    memset(b->d, 0, sizeof(uint32_t) * words);
+    b->n += words;
+}
+
+static int bignum_compare(const bignum *a, const bignum *b)
+{
+    if (a->n != b->n)
+        return a->n < b->n ? -1 : 1;
+    for (int i = a->n - 1; i >= 0; i--)
+        if (a->d[i] != b->d[i])
+            return a->d[i] < b->d[i] ? -1 : 1;
+    return 0;
+}
+
+/* compares a + b with c */
+static int bignum_plus_compare(const bignum *a, const bignum *b, const bignum *c)
+{
+    bignum sum;
+    uint64_t carry = 0;
+    int n = a->n > b->n ? a->n : b->n;
+    for (int i = 0; i < n; i++)
+    {
+        carry += (uint64_t)(i < a->n ? a->d[i] : 0) + (i < b->n ? b->d[i] : 0);
+        sum.d[i] = (uint32_t)carry;
+        carry >>= 32;
+    }
+    sum.n = n;
+    if (carry)
+        sum.d[sum.n++] = (uint32_t)carry;
+    return bignum_compare(&sum, c);
+}
+
+/* a -= b, for a >= b */
+static void bignum_sub(bignum *a, const bignum *b)
+{
+    int64_t borrow = 0;
+    for (int i = 0; i < a->n; i++)
+    {
+        borrow += (int64_t)a->d[i] - (i < b->n ? b->d[i] : 0);
+        a->d[i] = (uint32_t)borrow;
+        borrow = borrow < 0 ? -1 : 0;
+    }
+    while (a->n > 0 && a->d[a->n - 1] == 0)
+        a->n--;
+}
+
+static int bignum_dtoa(double value, char *digits, int *K)
+{
+    bignum r, s, mp, mm;
+    int e, len = 0;
+    uint64_t f = double_decompose(value, &e);
+    int even = !(f & 1), lower_closer = f == DP_HIDDEN_BIT && e > 1 - DP_EXPONENT_BIAS;
+    /* r/s = v, with m+ and m- the distances to the boundaries, all times 2
+     * (times 4 when the lower boundary is closer) to keep them integral */
+    bignum_set(&r, f);
+    bignum_set(&mm, 1);
+    if (e >= 0)
+    {
+        bignum_shl(&r, e + 1);
+        bignum_set(&s, 2);
+        bignum_shl(&mm, e);
+    }
+    else
+    {
+        bignum_shl(&r, 1);
+        bignum_set(&s, 1);
+        bignum_shl(&s, 1 - e);
+    }
+    mp = mm;
+    if (lower_closer)
+    {
+        bignum_shl(&r, 1);
+        bignum_shl(&s, 1);
+        bignum_shl(&mp, 1);
+    }
+    /* k = ceil(log10(v)), or one less */
+    int bits = 64;
+    while (!(f >> (bits - 1)))
+        bits--;
+    double dk = (e + bits - 1) * 0.30102999566398114 - 1e-10;
+    int k = (int)dk;
+    if (dk - k > 0.0)
+        k++;
+    if (k >= 0)
+        bignum_mul_pow10(&s, k);
+    else
+    {
+        bignum_mul_pow10(&r, -k);
+        bignum_mul_pow10(&mp, -k);
+        bignum_mul_pow10(&mm, -k);
+    }
+    if (bignum_plus_compare(&r, &mp, &s) >= (even ? 0 : 1))
+        k++;
+    else
+    {
+        bignum_mul(&r, 10);
+        bignum_mul(&mp, 10);
+        bignum_mul(&mm, 10);
+    }
+    for (;;)
+    {
+        char d = 0;
+        while (bignum_compare(&r, &s) >= 0)
+        {
+            bignum_sub(&r, &s);
+            d++;
+        }
+        digits[len++] = (char)('0' + d);
+        int low = bignum_compare(&r, &mm) < (even ? 1 : 0);
+        int high = bignum_plus_compare(&r, &mp, &s) >= (even ? 0 : 1);
+        if (low && high)
+        {
+            /* both neighbours are in the interval: take the closer, ties to even */
+            int c = bignum_plus_compare(&r, &r, &s);
+            if (c > 0 || (c == 0 && (d & 1)))
+                digits[len - 1]++;
             break;
-        case '\r':
-            *p++ = '\\';
-            *p++ = 'r';
+        }
+        if (low)
             break;
-        case '\t':
-            *p++ = '\\';
-            *p++ = 't';
+        if (high)
+        {
+            digits[len - 1]++;
             break;
-        default:
-            if (ch < 0x20)
+        }
+        bignum_mul(&r, 10);
+        bignum_mul(&mp, 10);
+        bignum_mul(&mm, 10);
+    }
+    *K = k - len;
+    return len;
+}
+
+/* Decimal to double without strtod(), so that neither LC_NUMERIC nor a
+ * locale call is involved. The 19 leading digits times a cached power of
+ * ten give a 64-bit approximation with a known error. When the bits it
+ * rounds away are far enough from a tie, that settles the result.
+ * Otherwise the digits are compared exactly with the midpoints to the
+ * neighbouring doubles, stepping until the value lies between them. At most
+ * NUMBER_MAX_DIGITS significant digits are kept; a final 1 stands in for
+ * the nonzero digits cut off, which rounds every halfway case the same. */
+#define NUMBER_MAX_DIGITS 780
+
+/* rounds w, normalized, to the nearest double; *sure is cleared when the
+ * bits cut off are within err of a tie, or the result over- or underflows */
+static double diy_fp_to_double(diy_fp w, uint64_t err, int *sure)
+{
+    int biased = w.e + 63 + DP_EXPONENT_BIAS - DP_SIGNIFICAND_SIZE, drop = 11;
+    uint64_t bits;
+    double d;
+    if (-1074 - w.e > drop)
+        drop = -1074 - w.e; /* subnormal: the last place is 2^-1074 */
+    if (drop >= 64 || biased >= 0x7FF)
+    {
+        *sure = 0;
+        bits = (drop >= 64) ? 0 : UINT64_C(0x7FEFFFFFFFFFFFFF);
+        memcpy(&d, &bits, sizeof(d));
+        return d;
+    }
+    uint64_t half = UINT64_C(1) << (drop - 1), low = w.f & ((half << 1) - 1), mant = w.f >> drop;
+    *sure = low + err < half || low > half + err;
+    if (low > half)
+        mant++;
+    /* the hidden bit of mant carries into the exponent, and so does a round up */
+    bits = (drop == 11) ? ((uint64_t)(biased - 1) << DP_SIGNIFICAND_SIZE) + mant : mant;
+    if (bits >= UINT64_C(0x7FF0000000000000))
+    {
+        *sure = 0;
+        bits = UINT64_C(0x7FEFFFFFFFFFFFFF);
+    }
+    memcpy(&d, &bits, sizeof(d));
+    return d;
+}
+
+/* compares digits * 10^exponent with m * 2^e */
+static int bignum_decimal_compare(const bignum *digits, int exponent, uint64_t m, int e)
+{
+    bignum a = *digits, b;
+    bignum_set(&b, m);
+    if (exponent >= 0)
+        bignum_mul_pow10(&a, exponent);
+    else
+        bignum_mul_pow10(&b, -exponent);
+    if (e >= 0)
+        bignum_shl(&b, e);
+    else
+        bignum_shl(&a, -e);
+    return bignum_compare(&a, &b);
+}
+
+static int number_slow_path(const char *json, size_t len, double *n)
+{
+    const char *p = json, *end = json + len;
+    char digits[NUMBER_MAX_DIGITS];
+    int count = 0, exponent = 0, fraction = 0, dropped = 0, negative = (*p == '-');
+    for (p += negative; p < end && *p != 'e' && *p != 'E'; p++)
+    {
+        if (*p == '.')
+            fraction = 1;
+        else if (count == 0 && *p == '0')
+            exponent -= fraction;
+        else if (count < NUMBER_MAX_DIGITS - 1)
+        {
+            digits[count++] = *p;
+            exponent -= fraction;
+        }
+        else
+        {
+            dropped |= *p != '0';
+            exponent += !fraction;
+        }
+    }
+    if (p < end)
+    {
+        int e = 0, e_negative = 0;
+        p++;
+        if (*p == '+' || *p == '-')
+            e_negative = (*p++ == '-');
+        for (; p < end; p++)
+            if (e < 100000)
+                e = e * 10 + (*p - '0');
+        exponent += e_negative ? -e : e;
+    }
+    if (dropped)
+    {
+        digits[count++] = '1';
+        exponent--;
+    }
+    while (count > 0 && digits[count - 1] == '0')
+    {
+        count--;
+        exponent++;
+    }
+    /* the value is in [10^(count + exponent - 1), 10^(count + exponent)) */
+    if (count == 0 || count + exponent < -323)
+    {
+        *n = negative ? -0.0 : 0.0;
+        return CJSON_PARSE_OK;
+    }
+    if (count + exponent > 309)
+        return CJSON_NUMBER_TOO_BIG;
+
+    diy_fp w, p10;
+    int used = count < 19 ? count : 19, k = count + exponent - used, sure;
+    w.f = 0;
+    for (int i = 0; i < used; i++)
+        w.f = w.f * 10 + (uint64_t)(digits[i] - '0');
+    w.e = 0;
+    while (!(w.f & (UINT64_C(1) << 63)))
+    {
+        w.f <<= 1;
+        w.e--;
+    }
+    /* 10^k = 10^r * 10^(k - r) from the table, whose exponents step by 8 */
+    unsigned index = (unsigned)(k + 348) / 8, r = (unsigned)(k + 348) % 8;
+    p10.f = pow10_u64[r];
+    p10.e = 0;
+    while (!(p10.f & (UINT64_C(1) << 63)))
+    {
+        p10.f <<= 1;
+        p10.e--;
+    }
+    w = diy_fp_multiply(w, p10);
+    p10.f = cached_powers_f[index];
+    p10.e = cached_powers_e[index];
+    w = diy_fp_multiply(w, p10);
+    while (!(w.f & (UINT64_C(1) << 63)))
+    {
+        w.f <<= 1;
+        w.e--;
+    }
+    double d = diy_fp_to_double(w, count > used ? 64 : 32, &sure);
+    if (!sure)
+    {
+        bignum big;
+        bignum_set(&big, 0);
+        for (int i = 0; i < count; i++)
+        {
+            bignum_mul(&big, 10);
+            bignum_add_small(&big, (uint32_t)(digits[i] - '0'));
+        }
+        for (;;)
+        {
+            uint64_t bits, f;
+            int e, c;
+            f = double_decompose(d, &e);
+            memcpy(&bits, &d, sizeof(bits));
+            c = bignum_decimal_compare(&big, exponent, 2 * f + 1, e - 1);
+            if (c > 0 || (c == 0 && (f & 1)))
             {
-                *p++ = '\\';
-                *p++ = 'u';
-                *p++ = '0';
-                *p++ = '0';
-                *p++ = hex_digits[ch >> 4];
-                *p++ = hex_digits[ch & 15];
+                if (bits == UINT64_C(0x7FEFFFFFFFFFFFFF))
+                    return CJSON_NUMBER_TOO_BIG;
+                bits++;
             }
+            else if (f == 0)
+                break;
             else
-                *p++ = s[i];
+            {
+                int lower_closer = f == DP_HIDDEN_BIT && e > 1 - DP_EXPONENT_BIAS;
+                c = lower_closer ? bignum_decimal_compare(&big, exponent, 4 * f - 1, e - 2)
+                                 : bignum_decimal_compare(&big, exponent, 2 * f - 1, e - 1);
+                if (!(c < 0 || (c == 0 && (f & 1))))
+                    break;
+                bits--;
+            }
+            memcpy(&d, &bits, sizeof(d));
         }
     }
-    *p++ = '"';
-    c->top -= size - (p - head);
+    *n = negative ? -d : d;
+    return CJSON_PARSE_OK;
+}
+
+/* Shortest round-trip form, laid out like ECMAScript's Number::toString:
+ * plain notation for decimal exponents in (-7, 21], otherwise d.ddde+N.
+ * Non-finite values have no JSON form and are written as null. */
+static char *format_double(char *buf, double d)
+{
+    char digits[20];
+    int len, K, point, i;
+    if (!isfinite(d))
+    {
+        memcpy(buf, "null", 4);
+        return buf + 4;
+    }
+    if (signbit(d))
+    {
+        *buf++ = '-';
+        d = -d;
+    }
+    if (d == 0)
+    {
+        *buf++ = '0';
+        return buf;
+    }
+    len = grisu3(d, digits, &K);
+    if (len == 0)
+        len = bignum_dtoa(d, digits, &K);
+    point = len + K; /* digits[0] is worth 10^(point - 1) */
+    if (len <= point && point <= 21)
+    {
+        memcpy(buf, digits, len);
+        memset(buf + len, '0', point - len);
+        return buf + point;
+    }
+    if (0 < point && point <= 21)
+    {
+        memcpy(buf, digits, point);
+        buf[point] = '.';
+        memcpy(buf + point + 1, digits + point, len - point);
+        return buf + len + 1;
+    }
+    if (-6 < point && point <= 0)
+    {
+        *buf++ = '0';
+        *buf++ = '.';
+        memset(buf, '0', -point);
+        memcpy(buf - point, digits, len);
+        return buf - point + len;
+    }
+    *buf++ = digits[0];
+    if (len > 1)
+    {
+        *buf++ = '.';
+        memcpy(buf, digits + 1, len - 1);
+        buf += len - 1;
+    }
+    *buf++ = 'e';
+    *buf++ = (point - 1 < 0) ? '-' : '+';
+    i = (point - 1 < 0) ? 1 - point : point - 1;
+    return format_uint64(buf, (uint64_t)i);
+}
+
+static void stringify_number(context *c, const cjson_value *v)
+{
+    char *buf = STRINGIFY_PUSH(c, 32);
+    if (v->flags & FLAG_INT64)
+        c->top -= 32 - (format_int64(buf, v->u.i64) - buf);
+    else if (v->flags & FLAG_UINT64)
+        c->top -= 32 - (format_uint64(buf, v->u.u64) - buf);
+    else
+        c->top -= 32 - (format_double(buf, v->u.n) - buf);
 }
 
 static void stringify_value(context *c, const cjson_value *v)
@@ -480,62 +3329,358 @@ static void stringify_value(context *c, const cjson_value *v)
     switch (v->type)
     {
     case CJSON_NULL:
-        memcpy(context_push(c, sizeof(char) * 4), "null", sizeof(char) * 4);
+        memcpy(STRINGIFY_PUSH(c, sizeof(char) * 4), "null", sizeof(char) * 4);
         break;
     case CJSON_TRUE:
-        memcpy(context_push(c, sizeof(char) * 4), "true", sizeof(char) * 4);
+        memcpy(STRINGIFY_PUSH(c, sizeof(char) * 4), "true", sizeof(char) * 4);
         break;
     case CJSON_FALSE:
-        memcpy(context_push(c, sizeof(char) * 5), "false", sizeof(char) * 5);
+        memcpy(STRINGIFY_PUSH(c, sizeof(char) * 5), "false", sizeof(char) * 5);
         break;
     case CJSON_NUMBER:
-        c->top -= 32 - sprintf(context_push(c, 32), "%.17g", v->u.n);
+        stringify_number(c, v);
         break;
     case CJSON_STRING:
-        stringify_string(c, v->u.s.s, v->u.s.len);
+        stringify_string(c, VALUE_STRING(v), VALUE_STRING_LENGTH(v));
         break;
     case CJSON_ARRAY:
-        PUTC(c, '[');
+        LAZY_MATERIALIZE(v);
+        OUTC(c, '[');
         for (size_t i = 0; i < v->u.a.size; i++)
         {
             if (i > 0)
-                PUTC(c, ',');
+                OUTC(c, ',');
             stringify_value(c, &(v->u.a.a[i]));
         }
-        PUTC(c, ']');
+        OUTC(c, ']');
         break;
     case CJSON_OBJECT:
-        PUTC(c, '{');
+        LAZY_MATERIALIZE(v);
+        OUTC(c, '{');
         for (size_t i = 0; i < v->u.o.size; i++)
         {
             if(i>0)
-                PUTC(c, ',');
-            stringify_string(c, v->u.o.m[i].key,v->u.o.m[i].len );
-            PUTC(c, ':');
+                OUTC(c, ',');
+            stringify_string(c, MEMBER_KEY(&v->u.o.m[i]), MEMBER_KEY_LENGTH(&v->u.o.m[i]));
+            OUTC(c, ':');
             stringify_value(c, &(v->u.o.m[i].v));
         }
-        PUTC(c, '}');
+        OUTC(c, '}');
         break;
     default:
     assert(0 &&"Invalid type");
     }
 }
 
+/* the UTF-16 sort key of the character at s[i]: its first code unit, then
+ * the code point to order characters sharing a high surrogate */
+static uint64_t utf16_order(const char *s, size_t len, size_t i)
+{
+    const unsigned char *u = (const unsigned char *)s + i;
+    size_t left = len - i;
+    uint32_t cp = u[0];
+    if (cp >= 0xF0 && left >= 4)
+        cp = ((cp & 0x07u) << 18) | ((u[1] & 0x3Fu) << 12) | ((u[2] & 0x3Fu) << 6) | (u[3] & 0x3Fu);
+    else if (cp >= 0xE0 && left >= 3)
+        cp = ((cp & 0x0Fu) << 12) | ((u[1] & 0x3Fu) << 6) | (u[2] & 0x3Fu);
+    else if (cp >= 0xC0 && left >= 2)
+        cp = ((cp & 0x1Fu) << 6) | (u[1] & 0x3Fu);
+    return (uint64_t)(cp < 0x10000 ? cp : 0xD800 + ((cp - 0x10000) >> 10)) << 32 | cp;
+}
+
+/* RFC 8785 orders keys by UTF-16 code units. UTF-8 byte order agrees except
+ * that characters above U+FFFF sort before U+E000-U+FFFF, so the keys are
+ * compared bytewise up to the first differing character. Equal keys keep
+ * their document order. */
+static int member_compare(const void *a, const void *b)
+{
+    const cjson_member *x = *(const cjson_member *const *)a, *y = *(const cjson_member *const *)b;
+    const char *xkey = MEMBER_KEY(x), *ykey = MEMBER_KEY(y);
+    size_t xlen = MEMBER_KEY_LENGTH(x), ylen = MEMBER_KEY_LENGTH(y);
+    size_t n = xlen < ylen ? xlen : ylen, i = 0;
+    while (i < n && xkey[i] == ykey[i])
+        i++;
+    if (i == n)
+    {
+        if (xlen != ylen)
+            return xlen < ylen ? -1 : 1;
+        return x < y ? -1 : (x > y);
+    }
+    while (i > 0 && ((unsigned char)xkey[i] & 0xC0) == 0x80)
+        i--;
+    return utf16_order(xkey, xlen, i) < utf16_order(ykey, ylen, i) ? -1 : 1;
+}
+
+/* RFC 8785 spells \u escapes with lowercase hex digits */
+static void stringify_string_ex(context *c, const char *s, size_t len, unsigned flags)
+{
+    size_t start = c->top;
+    stringify_string(c, s, len);
+    if (!(flags & CJSON_STRINGIFY_CANONICAL))
+        return;
+    for (char *p = c->stack + start + 1, *end = c->stack + c->top - 1; p < end; p++)
+    {
+        if (*p != '\\')
+            continue;
+        if (p[1] == 'u' && p[4] >= 'A')
+            p[4] += 'a' - 'A';
+        if (p[1] == 'u' && p[5] >= 'A')
+            p[5] += 'a' - 'A';
+        p += p[1] == 'u' ? 5 : 1;
+    }
+}
+
+/* RFC 8785 numbers are IEEE doubles in ECMAScript form, so integers are
+ * rounded to double, -0 prints as 0, and non-finite values are an error */
+static void stringify_number_ex(context *c, const cjson_value *v, unsigned flags)
+{
+    if (!(flags & CJSON_STRINGIFY_CANONICAL))
+    {
+        stringify_number(c, v);
+        return;
+    }
+    double d = v->u.n;
+    if (v->flags & FLAG_INT64)
+        d = (double)v->u.i64;
+    else if (v->flags & FLAG_UINT64)
+        d = (double)v->u.u64;
+    if (!isfinite(d))
+        c->write_status = 1;
+    char *buf = context_push(c, 32);
+    c->top -= 32 - (format_double(buf, d == 0 ? 0.0 : d) - buf);
+}
+
+static void stringify_indent(context *c, unsigned flags, size_t depth)
+{
+    size_t n = (flags & CJSON_STRINGIFY_INDENT_MASK) * depth;
+    char *p = context_push(c, n + 1);
+    *p = '\n';
+    memset(p + 1, ' ', n);
+}
+
+/* stringify_value() with cjson_stringify_ex() flags; kept apart so that the
+ * default path pays nothing for them */
+static void stringify_value_ex(context *c, const cjson_value *v, unsigned flags, size_t depth)
+{
+    const cjson_member *local[16], **order;
+    size_t i;
+    int indent = (flags & CJSON_STRINGIFY_INDENT_MASK) != 0;
+    switch (v->type)
+    {
+    case CJSON_NUMBER:
+        stringify_number_ex(c, v, flags);
+        break;
+    case CJSON_STRING:
+        stringify_string_ex(c, VALUE_STRING(v), VALUE_STRING_LENGTH(v), flags);
+        break;
+    case CJSON_ARRAY:
+        LAZY_MATERIALIZE(v);
+        PUTC(c, '[');
+        for (i = 0; i < v->u.a.size; i++)
+        {
+            if (i > 0)
+                PUTC(c, ',');
+            if (indent)
+                stringify_indent(c, flags, depth + 1);
+            stringify_value_ex(c, &v->u.a.a[i], flags, depth + 1);
+        }
+        if (indent && v->u.a.size > 0)
+            stringify_indent(c, flags, depth);
+        PUTC(c, ']');
+        break;
+    case CJSON_OBJECT:
+        LAZY_MATERIALIZE(v);
+        order = local;
+        if (v->u.o.size > sizeof(local) / sizeof(local[0]))
+            order = (const cjson_member **)malloc(v->u.o.size * sizeof(*order));
+        for (i = 0; i < v->u.o.size; i++)
+            order[i] = &v->u.o.m[i];
+        if (flags & CJSON_STRINGIFY_SORT_KEYS)
+            qsort((void *)order, v->u.o.size, sizeof(*order), member_compare);
+        PUTC(c, '{');
+        for (i = 0; i < v->u.o.size; i++)
+        {
+            if (i > 0)
+                PUTC(c, ',');
+            if (indent)
+                stringify_indent(c, flags, depth + 1);
+            stringify_string_ex(c, MEMBER_KEY(order[i]), MEMBER_KEY_LENGTH(order[i]), flags);
+            PUTC(c, ':');
+            if (indent)
+                PUTC(c, ' ');
+            stringify_value_ex(c, &order[i]->v, flags, depth + 1);
+        }
+        if (indent && v->u.o.size > 0)
+            stringify_indent(c, flags, depth);
+        PUTC(c, '}');
+        if (order != local)
+            free((void *)order);
+        break;
+    default: /* literals */
+        stringify_value(c, v);
+    }
+}
+
 char *cjson_stringify(const cjson_value *v, size_t *length)
 {
     assert(v != NULL);
     context c;
-    c.capacity = CONTEXT_STACK_DEFAULT_CAPACITY;
-    c.json = NULL;
-    c.top = 0;
-    c.stack = (char *)malloc(c.capacity);
+    memset(&c, 0, sizeof(context));
+    stringify_value(&c, v);
+    if (length)
+        *length = c.top;
+    PUTC(&c, '\0');
+    return c.stack;
+}
+
+char *cjson_stringify_ex(const cjson_value *v, unsigned flags, size_t *length)
+{
+    assert(v != NULL);
+    context c;
+    if (flags == 0)
+        return cjson_stringify(v, length);
+    if (flags & CJSON_STRINGIFY_CANONICAL)
+        flags = CJSON_STRINGIFY_CANONICAL | CJSON_STRINGIFY_SORT_KEYS;
+    memset(&c, 0, sizeof(context));
+    stringify_value_ex(&c, v, flags, 0);
+    if (c.write_status != 0)
+    {
+        free(c.stack);
+        return NULL;
+    }
+    if (length)
+        *length = c.top;
+    PUTC(&c, '\0');
+    return c.stack;
+}
+
+const char *cjson_context_stringify(cjson_context *ctx, const cjson_value *v, size_t *length)
+{
+    assert(ctx != NULL && v != NULL);
+    context c;
+    memset(&c, 0, sizeof(context));
+    c.stack = ctx->stack;
+    c.capacity = ctx->capacity;
     stringify_value(&c, v);
     if (length)
         *length = c.top;
     PUTC(&c, '\0');
+    ctx->stack = c.stack;
+    ctx->capacity = c.capacity;
     return c.stack;
 }
 
+int cjson_stringify_to(const cjson_value *v, cjson_write_fn write, void *userdata)
+{
+    assert(v != NULL && write != NULL);
+    char buf[CJSON_WRITE_BUFFER_SIZE];
+    context c;
+    memset(&c, 0, sizeof(context));
+    c.stack = buf;
+    c.capacity = sizeof(buf);
+    c.write = write;
+    c.userdata = userdata;
+    stringify_value(&c, v);
+    stringify_flush(&c);
+    return c.write_status;
+}
+
+static size_t string_size(const char *s, size_t len)
+{
+    const char *end = s + len;
+    size_t size = len + 2;
+    while ((s = scan_escape(s, end)) != end)
+    {
+        unsigned char ch = (unsigned char)*s++;
+        if (ch == '\"' || ch == '\\' || ch == '\b' || ch == '\f' || ch == '\n' || ch == '\r' || ch == '\t')
+            size += 1;
+        else
+            size += 5;
+    }
+    return size;
+}
+
+size_t cjson_stringify_size(const cjson_value *v)
+{
+    assert(v != NULL);
+    char buf[32];
+    size_t size;
+    switch (v->type)
+    {
+    case CJSON_NULL:
+    case CJSON_TRUE:
+        return 4;
+    case CJSON_FALSE:
+        return 5;
+    case CJSON_NUMBER:
+        if (v->flags & FLAG_INT64)
+            return format_int64(buf, v->u.i64) - buf;
+        if (v->flags & FLAG_UINT64)
+            return format_uint64(buf, v->u.u64) - buf;
+        return format_double(buf, v->u.n) - buf;
+    case CJSON_STRING:
+        return string_size(VALUE_STRING(v), VALUE_STRING_LENGTH(v));
+    case CJSON_ARRAY:
+        LAZY_MATERIALIZE(v);
+        size = v->u.a.size ? v->u.a.size + 1 : 2; /* brackets and commas */
+        for (size_t i = 0; i < v->u.a.size; i++)
+            size += cjson_stringify_size(&v->u.a.a[i]);
+        return size;
+    case CJSON_OBJECT:
+        LAZY_MATERIALIZE(v);
+        size = v->u.o.size ? 2 * v->u.o.size + 1 : 2; /* braces, colons and commas */
+        for (size_t i = 0; i < v->u.o.size; i++)
+            size += string_size(MEMBER_KEY(&v->u.o.m[i]), MEMBER_KEY_LENGTH(&v->u.o.m[i])) + cjson_stringify_size(&v->u.o.m[i].v);
+        return size;
+    default:
+        assert(0 && "Invalid type");
+        return 0;
+    }
+}
+
+static int into_overflow(void *userdata, const char *data, size_t len)
+{
+    (void)userdata;
+    (void)data;
+    (void)len;
+    return 1;
+}
+
+/* The output is written straight into buf, used as a sink buffer that must
+ * never be flushed. Reservations are worst cases (32 bytes per number, 6 per
+ * string byte), so a flush near the end does not prove the output is too
+ * long; then the exact size decides, and a fitting value is written again
+ * with the bound lifted. Nothing is written past the exact output. */
+size_t cjson_stringify_into(const cjson_value *v, char *buf, size_t cap)
+{
+    assert(v != NULL && (buf != NULL || cap == 0));
+    context c;
+    size_t size;
+    memset(&c, 0, sizeof(context));
+    c.stack = buf;
+    c.write = into_overflow;
+    if (cap > 32) /* the largest single reservation must fit */
+    {
+        c.capacity = cap - 1;
+        stringify_value(&c, v);
+        if (c.write_status == 0)
+        {
+            buf[c.top] = '\0';
+            return c.top;
+        }
+    }
+    if ((size = cjson_stringify_size(v)) < cap)
+    {
+        c.top = 0;
+        c.capacity = SIZE_MAX;
+        c.write_status = 0;
+        stringify_value(&c, v);
+        assert(c.top == size && c.write_status == 0);
+        buf[size] = '\0';
+    }
+    return size;
+}
+
 int cjson_get_boolean(const cjson_value *v)
 {
     assert(v != NULL && (v->type == CJSON_TRUE || v->type == CJSON_FALSE));
@@ -551,6 +3696,10 @@ void cjson_set_boolean(cjson_value *v, int bool)
 double cjson_get_number(const cjson_value *v)
 {
     assert(v != NULL && v->type == CJSON_NUMBER);
+    if (v->flags & FLAG_INT64)
+        return (double)v->u.i64;
+    if (v->flags & FLAG_UINT64)
+        return (double)v->u.u64;
     return v->u.n;
 }
 
@@ -558,25 +3707,79 @@ void cjson_set_number(cjson_value *v, double n)
 {
     assert(v != NULL);
     v->type = CJSON_NUMBER;
+    v->flags &= FLAG_KEY_MASK;
     v->u.n = n;
 }
 
+cjson_number_type cjson_get_number_type(const cjson_value *v)
+{
+    assert(v != NULL && v->type == CJSON_NUMBER);
+    if (v->flags & FLAG_INT64)
+        return CJSON_NUMBER_INT64;
+    if (v->flags & FLAG_UINT64)
+        return CJSON_NUMBER_UINT64;
+    return CJSON_NUMBER_DOUBLE;
+}
+
+int64_t cjson_get_int64(const cjson_value *v)
+{
+    assert(v != NULL && v->type == CJSON_NUMBER);
+    if (v->flags & FLAG_INT64)
+        return v->u.i64;
+    if (v->flags & FLAG_UINT64)
+        return (int64_t)v->u.u64;
+    return (int64_t)v->u.n;
+}
+
+void cjson_set_int64(cjson_value *v, int64_t i)
+{
+    assert(v != NULL);
+    v->type = CJSON_NUMBER;
+    v->flags = (v->flags & FLAG_KEY_MASK) | FLAG_INT64;
+    v->u.i64 = i;
+}
+
+uint64_t cjson_get_uint64(const cjson_value *v)
+{
+    assert(v != NULL && v->type == CJSON_NUMBER);
+    if (v->flags & FLAG_UINT64)
+        return v->u.u64;
+    if (v->flags & FLAG_INT64)
+        return (uint64_t)v->u.i64;
+    return (uint64_t)v->u.n;
+}
+
+void cjson_set_uint64(cjson_value *v, uint64_t u)
+{
+    assert(v != NULL);
+    v->type = CJSON_NUMBER;
+    v->flags = (v->flags & FLAG_KEY_MASK) | FLAG_UINT64;
+    v->u.u64 = u;
+}
+
 const char *cjson_get_string(const cjson_value *v)
 {
     assert(v != NULL && v->type == CJSON_STRING);
-    return v->u.s.s;
+    return VALUE_STRING(v);
 }
 
 size_t cjson_get_string_length(const cjson_value *v)
 {
     assert(v != NULL && v->type == CJSON_STRING);
-    return v->u.s.len;
+    return VALUE_STRING_LENGTH(v);
 }
 
 void cjson_set_string(cjson_value *v, const char *str, size_t str_len)
 {
     cjson_free(v);
+    assert(COMPACT_FITS(str_len));
     v->type = CJSON_STRING;
+    if (str != NULL && str_len <= INLINE_STRING_MAX)
+    {
+        v->flags |= FLAG_INLINE;
+        inline_store(INLINE_STRING(v), INLINE_STRING_MAX, str, str_len);
+        return;
+    }
     v->u.s.len = str_len;
     if (str == NULL)
     {
@@ -591,62 +3794,701 @@ void cjson_set_array(cjson_value *v, size_t capacity)
 {
     cjson_free(v);
     v->type = CJSON_ARRAY;
-    v->u.a.capacity = capacity;
+    SET_ARRAY_CAPACITY(v, capacity);
     v->u.a.size = 0;
-    v->u.a.a = (capacity > 0) ? (cjson_value *)malloc(sizeof(cjson_value) * capacity) : NULL;
+    v->u.a.a = (capacity > 0) ? (cjson_value *)container_buffer(malloc(CONTAINER_HEADER + sizeof(cjson_value) * capacity), capacity) : NULL;
 }
 
 size_t cjson_get_array_size(const cjson_value *v)
 {
     assert(v != NULL && v->type == CJSON_ARRAY);
+    LAZY_MATERIALIZE(v);
     return v->u.a.size;
 }
 size_t cjson_get_array_capacity(const cjson_value *v)
 {
     assert(v != NULL && v->type == CJSON_ARRAY);
-    return v->u.a.capacity;
+    LAZY_MATERIALIZE(v);
+    return ARRAY_CAPACITY(v);
 }
 
 cjson_value *cjson_get_array_element(cjson_value *v, size_t index)
 {
-    assert(v != NULL && v->type == CJSON_ARRAY && index < v->u.a.size);
+    assert(v != NULL && v->type == CJSON_ARRAY);
+    LAZY_MATERIALIZE(v);
+    assert(index < v->u.a.size);
     return &(v->u.a.a[index]);
 }
 
+/* an arena buffer moves to the heap here; its elements stay in the arena */
+static void array_resize(cjson_value *v, size_t capacity)
+{
+    assert(capacity >= v->u.a.size && capacity > 0);
+    value_detach(v); /* its parts must not stay in a block it no longer follows */
+    v->u.a.a = (cjson_value *)container_realloc(v->u.a.a, v->flags, sizeof(cjson_value) * v->u.a.size,
+                                                sizeof(cjson_value) * capacity, capacity);
+    v->flags &= ~FLAG_NOFREE;
+    SET_ARRAY_CAPACITY(v, capacity);
+}
+
+void cjson_array_reserve(cjson_value *v, size_t capacity)
+{
+    assert(v != NULL && v->type == CJSON_ARRAY);
+    LAZY_MATERIALIZE(v);
+    if (capacity > ARRAY_CAPACITY(v))
+        array_resize(v, capacity);
+}
+
+void cjson_array_shrink_to_fit(cjson_value *v)
+{
+    assert(v != NULL && v->type == CJSON_ARRAY);
+    LAZY_MATERIALIZE(v);
+    if (v->u.a.size == ARRAY_CAPACITY(v) || (v->flags & FLAG_NOFREE))
+        return;
+    if (v->u.a.size > 0)
+        array_resize(v, v->u.a.size);
+    else
+    {
+        container_release(v->u.a.a, v->flags);
+        v->flags &= ~FLAG_BLOCK;
+        v->u.a.a = NULL;
+        SET_ARRAY_CAPACITY(v, 0);
+    }
+}
+
+cjson_value *cjson_array_insert(cjson_value *v, size_t index, cjson_value *element)
+{
+    assert(v != NULL && v->type == CJSON_ARRAY);
+    LAZY_MATERIALIZE(v);
+    assert(index <= v->u.a.size);
+    cjson_value t;
+    cjson_init(&t);
+    if (element != NULL)
+        value_move(&t, element); /* element may be in the buffer that moves */
+    if (v->u.a.size == ARRAY_CAPACITY(v))
+        array_resize(v, container_grow(ARRAY_CAPACITY(v), v->u.a.size + 1));
+    cjson_value *slot = &v->u.a.a[index];
+    memmove(slot + 1, slot, sizeof(cjson_value) * (v->u.a.size - index));
+    v->u.a.size++;
+    cjson_init(slot);
+    value_move(slot, &t);
+    return slot;
+}
+
+cjson_value *cjson_array_push(cjson_value *v, cjson_value *element)
+{
+    assert(v != NULL && v->type == CJSON_ARRAY);
+    LAZY_MATERIALIZE(v);
+    return cjson_array_insert(v, v->u.a.size, element);
+}
+
+void cjson_array_erase(cjson_value *v, size_t index, size_t count)
+{
+    assert(v != NULL && v->type == CJSON_ARRAY);
+    LAZY_MATERIALIZE(v);
+    assert(index <= v->u.a.size && count <= v->u.a.size - index);
+    for (size_t i = index; i < index + count; i++)
+        cjson_free(&v->u.a.a[i]);
+    memmove(&v->u.a.a[index], &v->u.a.a[index + count], sizeof(cjson_value) * (v->u.a.size - index - count));
+    v->u.a.size -= count;
+}
+
 void cjson_set_object(cjson_value *v, size_t capacity)
 {
     cjson_free(v);
     v->type = CJSON_OBJECT;
-    v->u.o.capacity = capacity;
+    SET_OBJECT_CAPACITY(v, capacity);
     v->u.o.size = 0;
-    v->u.o.m = (capacity > 0) ? (cjson_member *)malloc(sizeof(cjson_member) * capacity) : NULL;
+    v->u.o.m = (capacity > 0) ? (cjson_member *)container_buffer(malloc(CONTAINER_HEADER + OBJECT_BUFFER_SIZE(capacity)), capacity) : NULL;
+    if (capacity >= OBJECT_INDEX_MIN)
+        OBJECT_INDEX(v) = NULL;
+}
+
+/* keys of equal length; interned keys usually match on the pointer alone */
+#define KEY_EQUAL(a, b, len) ((a) == (b) || (len) == 0 || memcmp((a), (b), (len)) == 0)
+
+/* member lookup with a precomputed key_hash(); builds the index on demand */
+static size_t object_find(cjson_value *v, const char *key, size_t klen, uint32_t hash)
+{
+    const cjson_member *m = v->u.o.m;
+    if (v->u.o.size >= OBJECT_INDEX_MIN)
+    {
+        object_index *idx = OBJECT_INDEX(v);
+        size_t mask;
+        if (idx == NULL || idx->size != v->u.o.size)
+        {
+            if (v->flags & FLAG_NOFREE)
+                goto linear; /* arena storage: cannot allocate a replacement */
+            free(idx);
+            idx = OBJECT_INDEX(v) = (object_index *)malloc(object_index_bytes(v->u.o.size, &mask));
+            object_index_build(idx, v, mask);
+        }
+        for (size_t j = hash & idx->mask; idx->slots[j].pos; j = (j + 1) & idx->mask)
+        {
+            const cjson_member *e = &m[idx->slots[j].pos - 1];
+            if (idx->slots[j].hash == hash && MEMBER_KEY_LENGTH(e) == klen && KEY_EQUAL(MEMBER_KEY(e), key, klen))
+                return idx->slots[j].pos - 1;
+        }
+        return CJSON_KEY_NOT_EXIST;
+    }
+linear:
+    for (size_t i = 0; i < v->u.o.size; i++)
+    {
+        if (MEMBER_KEY_LENGTH(&m[i]) == klen && KEY_EQUAL(MEMBER_KEY(&m[i]), key, klen))
+            return i;
+    }
+    return CJSON_KEY_NOT_EXIST;
+}
+
+size_t cjson_find_object_index(cjson_value *v, const char *key, size_t klen)
+{
+    assert(v != NULL && v->type == CJSON_OBJECT && (key != NULL || klen == 0));
+    LAZY_MATERIALIZE(v);
+    return object_find(v, key, klen, key_hash(key, klen));
+}
+
+cjson_value *cjson_find_object_value(cjson_value *v, const char *key, size_t klen)
+{
+    size_t index = cjson_find_object_index(v, key, klen);
+    return index != CJSON_KEY_NOT_EXIST ? &v->u.o.m[index].v : NULL;
+}
+
+/* JSON Pointer (RFC 6901). Each reference token selects an object member by
+ * key or an array element by index. A compiled path keeps the unescaped
+ * keys with their key_hash() and the index each token spells, so resolving
+ * it does no string work besides the key comparison. */
+/* decimal without leading zeros, as RFC 6901 requires of array indexes */
+static size_t pointer_index(const char *token, size_t len)
+{
+    size_t index = 0;
+    if (len == 0 || (token[0] == '0' && len > 1))
+        return CJSON_KEY_NOT_EXIST;
+    for (size_t i = 0; i < len; i++)
+    {
+        if (!ISDIGIT(token[i]) || index > (CJSON_KEY_NOT_EXIST - 1 - (size_t)(token[i] - '0')) / 10)
+            return CJSON_KEY_NOT_EXIST;
+        index = index * 10 + (size_t)(token[i] - '0');
+    }
+    return index;
+}
+
+/* length of the token at p once "~0" and "~1" are unescaped, or
+ * CJSON_KEY_NOT_EXIST for any other '~'; *end is set past the token */
+static size_t pointer_token_length(const char *p, const char **end)
+{
+    size_t len = 0;
+    for (; *p && *p != '/'; p++, len++)
+    {
+        if (*p == '~')
+        {
+            if (p[1] != '0' && p[1] != '1')
+                return CJSON_KEY_NOT_EXIST;
+            p++;
+        }
+    }
+    *end = p;
+    return len;
+}
+
+static void pointer_unescape(char *dst, const char *p, const char *end)
+{
+    for (; p < end; p++)
+        *dst++ = (*p == '~') ? (*++p == '0' ? '~' : '/') : *p;
+}
+
+static cjson_value *pointer_step(cjson_value *v, const char *key, size_t len, uint32_t hash, size_t index)
+{
+    size_t i;
+    switch (v->type)
+    {
+    case CJSON_OBJECT:
+        LAZY_MATERIALIZE(v);
+        i = object_find(v, key, len, hash);
+        return i != CJSON_KEY_NOT_EXIST ? &v->u.o.m[i].v : NULL;
+    case CJSON_ARRAY:
+        LAZY_MATERIALIZE(v);
+        return index < v->u.a.size ? &v->u.a.a[index] : NULL;
+    default:
+        return NULL;
+    }
+}
+
+cjson_value *cjson_pointer_get(cjson_value *v, const char *pointer)
+{
+    assert(v != NULL && pointer != NULL);
+    char local[64], *buf = local;
+    size_t capacity = sizeof(local);
+    while (v != NULL && *pointer)
+    {
+        const char *token, *end;
+        size_t len;
+        if (*pointer != '/' || (len = pointer_token_length(pointer + 1, &end)) == CJSON_KEY_NOT_EXIST)
+        {
+            v = NULL;
+            break;
+        }
+        token = pointer + 1;
+        if (len != (size_t)(end - token))
+        {
+            if (len > capacity)
+            {
+                if (buf != local)
+                    free(buf);
+                buf = (char *)malloc(capacity = len);
+            }
+            pointer_unescape(buf, token, end);
+            token = buf;
+        }
+        v = pointer_step(v, token, len, v->type == CJSON_OBJECT ? key_hash(token, len) : 0, pointer_index(token, len));
+        pointer = end;
+    }
+    if (buf != local)
+        free(buf);
+    return v;
+}
+
+cjson_path *cjson_path_compile(const char *pointer)
+{
+    assert(pointer != NULL);
+    size_t count = 0, bytes = 0, len;
+    const char *p, *end;
+    for (p = pointer; *p; p = end, count++)
+    {
+        if (*p != '/' || (len = pointer_token_length(p + 1, &end)) == CJSON_KEY_NOT_EXIST)
+            return NULL;
+        bytes += len + 1;
+    }
+    /* one block: the header, the segments, then the NUL-terminated keys */
+    size_t head = sizeof(cjson_path) + sizeof(path_segment) * (count ? count - 1 : 0);
+    cjson_path *path = (cjson_path *)malloc(head + bytes);
+    char *keys = (char *)path + head;
+    path->count = count;
+    for (p = pointer, count = 0; *p; p = end, count++)
+    {
+        path_segment *s = &path->segments[count];
+        s->len = pointer_token_length(p + 1, &end);
+        pointer_unescape(keys, p + 1, end);
+        keys[s->len] = '\0';
+        s->key = keys;
+        s->hash = key_hash(keys, s->len);
+        s->index = pointer_index(keys, s->len);
+        keys += s->len + 1;
+    }
+    return path;
+}
+
+cjson_value *cjson_path_get(const cjson_path *path, cjson_value *v)
+{
+    assert(path != NULL && v != NULL);
+    for (size_t i = 0; i < path->count && v != NULL; i++)
+    {
+        const path_segment *s = &path->segments[i];
+        v = pointer_step(v, s->key, s->len, s->hash, s->index);
+    }
+    return v;
+}
+
+void cjson_path_free(cjson_path *path)
+{
+    free(path);
+}
+
+static const projection_node *projection_member(const projection_node *node, const char *key, size_t len)
+{
+    uint32_t hash = key_hash(key, len);
+    for (node = node->child; node != NULL; node = node->next)
+        if (node->token.hash == hash && node->token.len == len && KEY_EQUAL(node->token.key, key, len))
+            return node;
+    return NULL;
+}
+
+static const projection_node *projection_element(const projection_node *node, size_t index)
+{
+    for (node = node->child; node != NULL; node = node->next)
+        if (node->token.index == index)
+            return node;
+    return NULL;
+}
+
+cjson_projection *cjson_projection_new(const cjson_path *const *paths, size_t count)
+{
+    assert(paths != NULL || count == 0);
+    size_t nodes = 1, bytes = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        nodes += paths[i]->count;
+        for (size_t j = 0; j < paths[i]->count; j++)
+            bytes += paths[i]->segments[j].len + 1;
+    }
+    /* one block: the nodes, at most one per token plus the root, then the keys */
+    size_t head = sizeof(cjson_projection) + sizeof(projection_node) * (nodes - 1);
+    cjson_projection *projection = (cjson_projection *)malloc(head + bytes);
+    projection_node *root = projection->nodes, *used = root + 1;
+    char *keys = (char *)projection + head;
+    memset(root, 0, sizeof(projection_node));
+    for (size_t i = 0; i < count; i++)
+    {
+        projection_node *node = root;
+        for (size_t j = 0; j < paths[i]->count; j++)
+        {
+            const path_segment *s = &paths[i]->segments[j];
+            projection_node *child = node->child;
+            while (child != NULL && !(child->token.hash == s->hash && child->token.len == s->len &&
+                                      KEY_EQUAL(child->token.key, s->key, s->len)))
+                child = child->next;
+            if (child == NULL)
+            {
+                child = used++;
+                memset(child, 0, sizeof(projection_node));
+                child->token = *s;
+                child->token.key = (const char *)memcpy(keys, s->key, s->len + 1);
+                keys += s->len + 1;
+                child->next = node->child;
+                node->child = child;
+                if (s->index != CJSON_KEY_NOT_EXIST && s->index >= node->elements)
+                    node->elements = s->index + 1;
+            }
+            node = child;
+        }
+        node->keep = 1;
+    }
+    return projection;
+}
+
+void cjson_projection_free(cjson_projection *projection)
+{
+    free(projection);
+}
+
+size_t cjson_get_object_size(const cjson_value *v)
+{
+    assert(v != NULL && v->type == CJSON_OBJECT);
+    LAZY_MATERIALIZE(v);
+    return v->u.o.size;
+}
+
+const char *cjson_get_object_key(const cjson_value *v, size_t index)
+{
+    assert(v != NULL && v->type == CJSON_OBJECT);
+    LAZY_MATERIALIZE(v);
+    assert(index < v->u.o.size);
+    return MEMBER_KEY(&v->u.o.m[index]);
+}
+
+size_t cjson_get_object_key_length(const cjson_value *v, size_t index)
+{
+    assert(v != NULL && v->type == CJSON_OBJECT);
+    LAZY_MATERIALIZE(v);
+    assert(index < v->u.o.size);
+    return MEMBER_KEY_LENGTH(&v->u.o.m[index]);
+}
+
+cjson_value *cjson_get_object_value(cjson_value *v, size_t index)
+{
+    assert(v != NULL && v->type == CJSON_OBJECT);
+    LAZY_MATERIALIZE(v);
+    assert(index < v->u.o.size);
+    return &v->u.o.m[index].v;
+}
+
+/* Like array_resize(). The hash index pointer moves to the slot after the
+ * new m[capacity]; an index in an arena is dropped and rebuilt on demand. */
+static void object_resize(cjson_value *v, size_t capacity)
+{
+    assert(capacity >= v->u.o.size && capacity > 0);
+    value_detach(v);
+    int borrowed = v->flags & FLAG_NOFREE;
+    object_index *idx = (OBJECT_CAPACITY(v) >= OBJECT_INDEX_MIN && !borrowed) ? OBJECT_INDEX(v) : NULL;
+    v->u.o.m = (cjson_member *)container_realloc(v->u.o.m, v->flags, sizeof(cjson_member) * v->u.o.size,
+                                                 OBJECT_BUFFER_SIZE(capacity), capacity);
+    v->flags &= ~FLAG_NOFREE;
+    SET_OBJECT_CAPACITY(v, capacity);
+    if (capacity >= OBJECT_INDEX_MIN)
+        OBJECT_INDEX(v) = idx;
+    else
+        free(idx);
+}
+
+/* adds the last member to an index that was current before it; an index
+ * that would be over half full is rebuilt at twice the size */
+static void object_index_append(cjson_value *v, uint32_t hash)
+{
+    size_t size = v->u.o.size, mask;
+    object_index *idx;
+    if (OBJECT_CAPACITY(v) < OBJECT_INDEX_MIN || (idx = OBJECT_INDEX(v)) == NULL || idx->size != size - 1)
+        return;
+    if (2 * size > idx->mask + 1)
+    {
+        if (v->flags & FLAG_NOFREE)
+            OBJECT_INDEX(v) = NULL; /* arena storage: lookups fall back to a scan */
+        else
+        {
+            idx = OBJECT_INDEX(v) = (object_index *)realloc(idx, object_index_bytes(size, &mask));
+            object_index_build(idx, v, mask);
+        }
+        return;
+    }
+    size_t j = hash & idx->mask;
+    while (idx->slots[j].pos)
+        j = (j + 1) & idx->mask;
+    idx->slots[j].hash = hash;
+    idx->slots[j].pos = (uint32_t)size;
+    idx->size = size;
+}
+
+void cjson_object_reserve(cjson_value *v, size_t capacity)
+{
+    assert(v != NULL && v->type == CJSON_OBJECT);
+    LAZY_MATERIALIZE(v);
+    if (capacity > OBJECT_CAPACITY(v))
+        object_resize(v, capacity);
+}
+
+cjson_value *cjson_object_set(cjson_value *v, const char *key, size_t klen, cjson_value *value)
+{
+    assert(v != NULL && v->type == CJSON_OBJECT && (key != NULL || klen == 0));
+    LAZY_MATERIALIZE(v);
+    uint32_t hash = key_hash(key, klen);
+    size_t i = object_find(v, key, klen, hash);
+    cjson_member *m;
+    cjson_value t;
+    cjson_init(&t);
+    if (value != NULL)
+        value_move(&t, value); /* value may be a member that is replaced or moves */
+    if (i != CJSON_KEY_NOT_EXIST)
+    {
+        m = &v->u.o.m[i];
+        cjson_free(&m->v);
+    }
+    else
+    {
+        context c;
+        memset(&c, 0, sizeof(context));
+        if (v->u.o.size == OBJECT_CAPACITY(v))
+            object_resize(v, container_grow(OBJECT_CAPACITY(v), v->u.o.size + 1));
+        m = &v->u.o.m[v->u.o.size++];
+        cjson_init(&m->v);
+        m->v.flags = context_set_key(&c, m, key, klen);
+        object_index_append(v, hash);
+    }
+    value_move(&m->v, &t);
+    return &m->v;
+}
+
+int cjson_object_remove(cjson_value *v, const char *key, size_t klen)
+{
+    assert(v != NULL && v->type == CJSON_OBJECT && (key != NULL || klen == 0));
+    LAZY_MATERIALIZE(v);
+    size_t i = object_find(v, key, klen, key_hash(key, klen));
+    if (i == CJSON_KEY_NOT_EXIST)
+        return 0;
+    object_index *idx = (OBJECT_CAPACITY(v) >= OBJECT_INDEX_MIN) ? OBJECT_INDEX(v) : NULL;
+    int current = idx != NULL && idx->size == v->u.o.size;
+    member_free(&v->u.o.m[i]);
+    memmove(&v->u.o.m[i], &v->u.o.m[i + 1], sizeof(cjson_member) * (v->u.o.size - i - 1));
+    v->u.o.size--;
+    /* later members moved down, so renumber them; the table keeps its size */
+    if (current)
+        object_index_build(idx, v, idx->mask);
+    return 1;
 }
 
 void cjson_free(cjson_value *v)
 {
     assert(v != NULL);
-    switch (v->type)
+    switch ((v->flags & FLAG_LAZY) ? CJSON_NULL : v->type) /* lazy nodes own nothing */
     {
     case CJSON_STRING:
-        free(v->u.s.s);
+        if (!(v->flags & (FLAG_NOFREE | FLAG_INLINE)))
+            free(v->u.s.s);
         break;
     case CJSON_ARRAY:
         for (size_t i = 0; i < v->u.a.size; i++)
         {
             cjson_free(&(v->u.a.a[i]));
         }
-        free(v->u.a.a);
+        container_release(v->u.a.a, v->flags);
         break;
     case CJSON_OBJECT:
         for (size_t i = 0; i < v->u.o.size; i++)
         {
-            free(v->u.o.m[i].key);
-            cjson_free(&(v->u.o.m[i].v));
+            member_free(&(v->u.o.m[i]));
         }
-        free(v->u.o.m);
+        if (!(v->flags & FLAG_NOFREE) && OBJECT_CAPACITY(v) >= OBJECT_INDEX_MIN)
+            free(OBJECT_INDEX(v));
+        container_release(v->u.o.m, v->flags);
         break;
     default:
         break;
     }
     v->type = CJSON_NULL;
-}
\ No newline at end of file
+    v->flags &= FLAG_KEY_MASK;
+}
+void cjson_move(cjson_value *dst, cjson_value *src)
+{
+    assert(dst != NULL && src != NULL);
+    cjson_value t;
+    if (dst == src)
+        return;
+    cjson_init(&t);
+    value_move(&t, src); /* src may be inside dst */
+    cjson_free(dst);
+    value_move(dst, &t);
+}
+
+void cjson_swap(cjson_value *a, cjson_value *b)
+{
+    assert(a != NULL && b != NULL);
+    value_detach(a);
+    value_detach(b);
+    unsigned key_a = a->flags & FLAG_KEY_MASK, key_b = b->flags & FLAG_KEY_MASK;
+    cjson_value t = *a;
+    *a = *b;
+    *b = t;
+    a->flags = (a->flags & ~FLAG_KEY_MASK) | key_a;
+    b->flags = (b->flags & ~FLAG_KEY_MASK) | key_b;
+}
+
+/* Deep copy. copy_size() measures the buffers below a value, each rounded
+ * like an arena allocation, so that copy_into() can carve them from a single
+ * block. index says whether an object gets its hash index in that storage. */
+typedef struct copy_state
+{
+    cjson_arena *arena; /* or NULL to carve from next */
+    char *next;
+    unsigned borrowed; /* flags for a buffer carved from the storage */
+} copy_state;
+
+static void *copy_alloc(copy_state *s, size_t size)
+{
+    void *p;
+    if (s->arena)
+        return arena_alloc(s->arena, size);
+    p = s->next;
+    s->next += ARENA_ALIGN(size);
+    return p;
+}
+
+static size_t copy_size(const cjson_value *v, int index)
+{
+    size_t n = 0, mask;
+    LAZY_MATERIALIZE(v);
+    switch (v->type)
+    {
+    case CJSON_STRING:
+        return (v->flags & FLAG_INLINE || v->u.s.s == NULL) ? 0 : ARENA_ALIGN(v->u.s.len + 1);
+    case CJSON_ARRAY:
+        if (v->u.a.size > 0)
+            n = ARENA_ALIGN(CONTAINER_HEADER + sizeof(cjson_value) * v->u.a.size);
+        for (size_t i = 0; i < v->u.a.size; i++)
+            n += copy_size(&v->u.a.a[i], 1);
+        return n;
+    case CJSON_OBJECT:
+        if (v->u.o.size > 0)
+            n = ARENA_ALIGN(CONTAINER_HEADER + OBJECT_BUFFER_SIZE(v->u.o.size));
+        if (index && v->u.o.size >= OBJECT_INDEX_MIN)
+            n += ARENA_ALIGN(object_index_bytes(v->u.o.size, &mask));
+        for (size_t i = 0; i < v->u.o.size; i++)
+        {
+            const cjson_member *m = &v->u.o.m[i];
+            if (!(m->v.flags & FLAG_KEY_INLINE))
+                n += ARENA_ALIGN(m->len + 1);
+            n += copy_size(&m->v, 1);
+        }
+        return n;
+    default:
+        return 0;
+    }
+}
+
+/* copies src over dst, which keeps its key flags; every buffer is borrowed */
+static void copy_into(copy_state *s, cjson_value *dst, const cjson_value *src, int index)
+{
+    unsigned key_flags = dst->flags & FLAG_KEY_MASK;
+    size_t size, mask;
+    *dst = *src;
+    dst->flags = (src->flags & ~(FLAG_KEY_MASK | FLAG_NOFREE | FLAG_BLOCK)) | key_flags;
+    switch (src->type)
+    {
+    case CJSON_STRING:
+        if (!(src->flags & FLAG_INLINE) && src->u.s.s != NULL)
+        {
+            dst->u.s.s = (char *)memcpy(copy_alloc(s, src->u.s.len + 1), src->u.s.s, src->u.s.len + 1);
+            dst->flags |= s->borrowed;
+        }
+        break;
+    case CJSON_ARRAY:
+        size = src->u.a.size;
+        dst->flags |= s->borrowed;
+        SET_ARRAY_CAPACITY(dst, size);
+        dst->u.a.a = (size > 0) ? (cjson_value *)container_buffer(copy_alloc(s, CONTAINER_HEADER + sizeof(cjson_value) * size), size) : NULL;
+        for (size_t i = 0; i < size; i++)
+        {
+            cjson_init(&dst->u.a.a[i]);
+            copy_into(s, &dst->u.a.a[i], &src->u.a.a[i], 1);
+        }
+        break;
+    case CJSON_OBJECT:
+        size = src->u.o.size;
+        dst->flags |= s->borrowed;
+        SET_OBJECT_CAPACITY(dst, size);
+        dst->u.o.m = (size > 0) ? (cjson_member *)container_buffer(copy_alloc(s, CONTAINER_HEADER + OBJECT_BUFFER_SIZE(size)), size) : NULL;
+        for (size_t i = 0; i < size; i++)
+        {
+            const cjson_member *sm = &src->u.o.m[i];
+            cjson_member *dm = &dst->u.o.m[i];
+            memcpy(dm, sm, sizeof(cjson_member)); /* inline keys come along */
+            if (sm->v.flags & FLAG_KEY_INLINE)
+                dm->v.flags = FLAG_KEY_INLINE;
+            else
+            {
+                dm->key = (char *)memcpy(copy_alloc(s, sm->len + 1), sm->key, sm->len + 1);
+                dm->v.flags = FLAG_KEY_NOFREE;
+            }
+            copy_into(s, &dm->v, &sm->v, 1);
+        }
+        if (size >= OBJECT_INDEX_MIN)
+        {
+            OBJECT_INDEX(dst) = NULL;
+            if (index)
+            {
+                size_t bytes = object_index_bytes(size, &mask);
+                OBJECT_INDEX(dst) = object_index_build((object_index *)copy_alloc(s, bytes), dst, mask);
+            }
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+void cjson_copy(cjson_value *dst, const cjson_value *src, cjson_arena *arena)
+{
+    assert(dst != NULL && src != NULL);
+    copy_state s;
+    cjson_value t;
+    int index = arena != NULL; /* a heap copy builds its root index on demand */
+    size_t bytes = copy_size(src, index);
+    int container = src->type == CJSON_ARRAY || src->type == CJSON_OBJECT;
+    char *block = NULL;
+    s.arena = arena;
+    s.next = NULL;
+    s.borrowed = arena ? FLAG_NOFREE : FLAG_NOFREE | FLAG_BLOCK;
+    if (arena == NULL && bytes > 0)
+    {
+        /* the root buffer comes first, so freeing the root frees the block */
+        block = (char *)malloc((container ? BLOCK_OWNER : 0) + bytes);
+        s.next = block;
+        if (container)
+        {
+            *(void **)block = NULL;
+            s.next += BLOCK_OWNER;
+        }
+    }
+    cjson_init(&t);
+    copy_into(&s, &t, src, index); /* src may be inside dst */
+    if (arena == NULL)
+        t.flags = (t.flags & ~(FLAG_NOFREE | FLAG_BLOCK)) | (container && block != NULL ? FLAG_BLOCK : 0u);
+    cjson_free(dst);
+    value_move(dst, &t);
+}
@@ -1,10 +1,17 @@
 #ifndef CJSON_H
 #define CJSON_H
 #include <stddef.h>
+#include <stdint.h>
 
 
 typedef struct cjson_value cjson_value;
 typedef struct cjson_member cjson_member;
+typedef struct cjson_arena cjson_arena;
+typedef struct cjson_parser cjson_parser;
+typedef struct cjson_context cjson_context;
+typedef struct cjson_key_table cjson_key_table;
+typedef struct cjson_path cjson_path;
+typedef struct cjson_projection cjson_projection;
 
 enum 
 {
@@ -21,13 +28,39 @@ enum
     CJSON_MISS_KEY,
     CJSON_MISS_COLON,
     CJSON_MISS_COMMA_OR_SQUARE_BRACKET,
-    CJSON_MISS_COMMA_OR_CURLY_BRACKET
+    CJSON_MISS_COMMA_OR_CURLY_BRACKET,
+    CJSON_SAX_ABORTED,
+    CJSON_PARSE_NEED_MORE
 };
 
 typedef enum{
     CJSON_NULL, CJSON_TRUE, CJSON_FALSE, CJSON_NUMBER, CJSON_STRING, CJSON_ARRAY, CJSON_OBJECT
 }cjson_type;
 
+typedef enum{
+    CJSON_NUMBER_DOUBLE, CJSON_NUMBER_INT64, CJSON_NUMBER_UINT64
+}cjson_number_type;
+
+#ifdef CJSON_COMPACT
+/* 16 bytes: counts are 32-bit and packed after the pointer, and array and
+ * object capacities are stored in front of the element buffer. Must be
+ * defined the same way for the library and every user. */
+#pragma pack(push, 4)
+struct cjson_value
+{
+    union{
+        struct {cjson_member * m; uint32_t size; } o;
+        struct {cjson_value * a; uint32_t size; }a;
+        struct { char * s; uint32_t len;}s;
+        double n;
+        int64_t i64;
+        uint64_t u64;
+    }u;
+    unsigned char type; /* cjson_type */
+    unsigned char flags; /* internal storage bits, managed by the library */
+};
+#pragma pack(pop)
+#else
 struct cjson_value
 {
     union{
@@ -35,9 +68,13 @@ struct cjson_value
         struct {cjson_value * a; size_t size; size_t capacity; }a;
         struct { char * s; size_t len;}s;
         double n;
+        int64_t i64;
+        uint64_t u64;
     }u;
     cjson_type type;
+    unsigned flags; /* internal storage bits, managed by the library */
 };
+#endif
 
 struct cjson_member
 {
@@ -46,15 +83,92 @@ struct cjson_member
     cjson_value v;
 };
 
-#define cjson_init(cjson_value_ptr) do { (cjson_value_ptr)->type = CJSON_NULL; } while(0)
+enum
+{
+    CJSON_PARSE_STRUCTURAL_INDEX = 1 << 0,
+    CJSON_PARSE_LAZY = 1 << 1, /* validate now, decode containers on first access; buf must outlive the value */
+    CJSON_PARSE_SKIP_UNVALIDATED = 1 << 2 /* step over subtrees outside the projection without checking them */
+};
+
+typedef struct cjson_parse_options
+{
+    unsigned flags;
+    cjson_arena *arena;
+    cjson_context *context; /* reuse this stack instead of allocating one */
+    cjson_key_table *keys;  /* share keys through this table; it must outlive the document */
+    const cjson_projection *projection; /* build only the subtrees these paths select */
+} cjson_parse_options;
+
+#define cjson_init(cjson_value_ptr) do { (cjson_value_ptr)->type = CJSON_NULL; (cjson_value_ptr)->flags = 0; } while(0)
 int cjson_parse(cjson_value * v, const char * json_str);
+int cjson_parse_n(cjson_value *v, const char *buf, size_t len);
+int cjson_parse_ex(cjson_value *v, const char *buf, size_t len, const cjson_parse_options *opts);
 void cjson_free(cjson_value * v);
+/* O(1): src is moved into dst and left null; key bits of members stay put */
+void cjson_move(cjson_value *dst, cjson_value *src);
+void cjson_swap(cjson_value *a, cjson_value *b);
+/* deep copy in one block owned by dst, or in arena if not NULL */
+void cjson_copy(cjson_value *dst, const cjson_value *src, cjson_arena *arena);
+
+/* Event callbacks for cjson_parse_sax(). Any callback may be NULL. A non-zero
+ * return stops the parse with CJSON_SAX_ABORTED. Strings and keys are
+ * NUL-terminated and valid only during the call. */
+typedef struct cjson_sax_handler
+{
+    int (*on_null)(void *userdata);
+    int (*on_boolean)(void *userdata, int b);
+    int (*on_number)(void *userdata, const cjson_value *number);
+    int (*on_string)(void *userdata, const char *str, size_t len);
+    int (*on_start_object)(void *userdata);
+    int (*on_key)(void *userdata, const char *key, size_t len);
+    int (*on_end_object)(void *userdata, size_t member_count);
+    int (*on_start_array)(void *userdata);
+    int (*on_end_array)(void *userdata, size_t element_count);
+} cjson_sax_handler;
+int cjson_parse_sax(const char *buf, size_t len, const cjson_sax_handler *handler, void *userdata);
+
+typedef struct cjson_ndjson_record
+{
+    cjson_value v;
+    int error;     /* parse result for this line; v is null unless CJSON_PARSE_OK */
+    size_t offset; /* where the line starts in the input */
+    size_t length; /* line length without the newline */
+} cjson_ndjson_record;
+size_t cjson_parse_ndjson(const char *buf, size_t len, unsigned threads, cjson_ndjson_record **records);
+void cjson_ndjson_free(cjson_ndjson_record *records, size_t count);
+
+cjson_parser *cjson_parser_new(const cjson_parse_options *opts);
+int cjson_parser_feed(cjson_parser *p, const char *chunk, size_t len);
+int cjson_parser_finish(cjson_parser *p, cjson_value *v);
+void cjson_parser_free(cjson_parser *p);
+
+cjson_context *cjson_context_new(void);
+void cjson_context_reset(cjson_context *ctx);
+void cjson_context_trim(cjson_context *ctx);
+void cjson_context_free(cjson_context *ctx);
+
+/* Not thread-safe: parses sharing a table must not run concurrently. */
+cjson_key_table *cjson_key_table_new(void);
+const char *cjson_key_table_intern(cjson_key_table *keys, const char *key, size_t len);
+size_t cjson_key_table_size(const cjson_key_table *keys);
+void cjson_key_table_free(cjson_key_table *keys);
+
+cjson_arena *cjson_arena_new(size_t block_size);
+void cjson_arena_reset(cjson_arena *arena);
+void cjson_arena_free(cjson_arena *arena);
+int cjson_parse_arena(cjson_value *v, const char *json_str, cjson_arena *arena);
+int cjson_parse_insitu(cjson_value *v, char *buf, size_t len);
 
 int cjson_get_boolean(const cjson_value * v);
 void cjson_set_boolean(cjson_value * v, int bool);
 
 double cjson_get_number(const cjson_value * v);
 void cjson_set_number(cjson_value * v, double n);
+cjson_number_type cjson_get_number_type(const cjson_value *v);
+int64_t cjson_get_int64(const cjson_value *v);
+void cjson_set_int64(cjson_value *v, int64_t i);
+uint64_t cjson_get_uint64(const cjson_value *v);
+void cjson_set_uint64(cjson_value *v, uint64_t u);
 
 const char * cjson_get_string(const cjson_value * v);
 size_t cjson_get_string_length(const cjson_value * v);
@@ -64,8 +178,51 @@ void cjson_set_array(cjson_value *v, size_t capacity);
 size_t cjson_get_array_size(const cjson_value *v);
 size_t cjson_get_array_capacity(const cjson_value *v);
 cjson_value *cjson_get_array_element(cjson_value *v, size_t index);
+/* element is moved in and left null; NULL appends a null. element may be
+ * inside v. Growing the buffer invalidates pointers to elements. */
+cjson_value *cjson_array_push(cjson_value *v, cjson_value *element);
+cjson_value *cjson_array_insert(cjson_value *v, size_t index, cjson_value *element);
+void cjson_array_erase(cjson_value *v, size_t index, size_t count);
+void cjson_array_reserve(cjson_value *v, size_t capacity);
+void cjson_array_shrink_to_fit(cjson_value *v);
 
 void cjson_set_object(cjson_value *v, size_t capacity);
+#define CJSON_KEY_NOT_EXIST ((size_t)-1)
+size_t cjson_find_object_index(cjson_value *v, const char *key, size_t klen);
+cjson_value *cjson_find_object_value(cjson_value *v, const char *key, size_t klen);
+/* short keys are stored in the member itself rather than behind key, so read keys through these */
+const char *cjson_get_object_key(const cjson_value *v, size_t index);
+size_t cjson_get_object_key_length(const cjson_value *v, size_t index);
+size_t cjson_get_object_size(const cjson_value *v);
+cjson_value *cjson_get_object_value(cjson_value *v, size_t index);
+/* replaces the value of key or appends a member; value is moved in as
+ * above and may be inside v */
+cjson_value *cjson_object_set(cjson_value *v, const char *key, size_t klen, cjson_value *value);
+int cjson_object_remove(cjson_value *v, const char *key, size_t klen);
+void cjson_object_reserve(cjson_value *v, size_t capacity);
+
+/* JSON Pointer (RFC 6901); NULL if the pointer is malformed or names nothing */
+cjson_value *cjson_pointer_get(cjson_value *v, const char *pointer);
+cjson_path *cjson_path_compile(const char *pointer);
+cjson_value *cjson_path_get(const cjson_path *path, cjson_value *v);
+void cjson_path_free(cjson_path *path);
+cjson_projection *cjson_projection_new(const cjson_path *const *paths, size_t count);
+void cjson_projection_free(cjson_projection *projection);
 
 char *cjson_stringify(const cjson_value *v, size_t *length);
+/* cjson_stringify_ex() flags; the low four bits are the indent width */
+enum
+{
+    CJSON_STRINGIFY_INDENT_MASK = 0xF,
+    CJSON_STRINGIFY_SORT_KEYS = 1 << 4,
+    CJSON_STRINGIFY_CANONICAL = 1 << 5 /* RFC 8785; implies sorted keys and no indent */
+};
+#define CJSON_STRINGIFY_INDENT(n) ((unsigned)(n) & CJSON_STRINGIFY_INDENT_MASK)
+char *cjson_stringify_ex(const cjson_value *v, unsigned flags, size_t *length);
+/* receives the output in order; a non-zero return stops stringification */
+typedef int (*cjson_write_fn)(void *userdata, const char *data, size_t len);
+int cjson_stringify_to(const cjson_value *v, cjson_write_fn write, void *userdata);
+const char *cjson_context_stringify(cjson_context *ctx, const cjson_value *v, size_t *length);
+size_t cjson_stringify_size(const cjson_value *v);
+size_t cjson_stringify_into(const cjson_value *v, char *buf, size_t cap);
 #endif /*CJSON_H*/
\ No newline at end of file
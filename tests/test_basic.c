@@ -2,6 +2,7 @@
 #include <stdio.h>
 #include <string.h>
 #include <assert.h>
+#include <stdlib.h>
 
 void test_null() {
     cjson_value v;
@@ -54,6 +55,55 @@ void test_number() {
     printf("✓ test_number passed\n");
 }
 
+void test_integer() {
+    cjson_value v;
+    cjson_init(&v);
+    
+    // Integral literals are stored exactly
+    assert(cjson_parse(&v, "9007199254740993") == CJSON_PARSE_OK);
+    assert(cjson_get_number_type(&v) == CJSON_NUMBER_INT64);
+    assert(cjson_get_int64(&v) == INT64_C(9007199254740993));
+    cjson_free(&v);
+    
+    assert(cjson_parse(&v, "-9223372036854775808") == CJSON_PARSE_OK);
+    assert(cjson_get_number_type(&v) == CJSON_NUMBER_INT64);
+    assert(cjson_get_int64(&v) == INT64_MIN);
+    cjson_free(&v);
+    
+    assert(cjson_parse(&v, "18446744073709551615") == CJSON_PARSE_OK);
+    assert(cjson_get_number_type(&v) == CJSON_NUMBER_UINT64);
+    assert(cjson_get_uint64(&v) == UINT64_MAX);
+    assert(cjson_get_number(&v) == 18446744073709551615.0);
+    cjson_free(&v);
+    
+    // Out-of-range integers, fractions, exponents and -0 stay doubles
+    assert(cjson_parse(&v, "18446744073709551616") == CJSON_PARSE_OK);
+    assert(cjson_get_number_type(&v) == CJSON_NUMBER_DOUBLE);
+    assert(cjson_parse(&v, "-9223372036854775809") == CJSON_PARSE_OK);
+    assert(cjson_get_number_type(&v) == CJSON_NUMBER_DOUBLE);
+    assert(cjson_get_number(&v) == -9223372036854775809.0);
+    assert(cjson_parse(&v, "1.0") == CJSON_PARSE_OK);
+    assert(cjson_get_number_type(&v) == CJSON_NUMBER_DOUBLE);
+    assert(cjson_get_int64(&v) == 1);
+    assert(cjson_parse(&v, "1e2") == CJSON_PARSE_OK);
+    assert(cjson_get_number_type(&v) == CJSON_NUMBER_DOUBLE);
+    assert(cjson_parse(&v, "-0") == CJSON_PARSE_OK);
+    assert(cjson_get_number_type(&v) == CJSON_NUMBER_DOUBLE);
+    
+    // Setters
+    cjson_set_int64(&v, -42);
+    assert(cjson_get_number_type(&v) == CJSON_NUMBER_INT64);
+    assert(cjson_get_number(&v) == -42.0);
+    cjson_set_uint64(&v, UINT64_C(12345678901234567890));
+    assert(cjson_get_uint64(&v) == UINT64_C(12345678901234567890));
+    cjson_set_number(&v, 0.5);
+    assert(cjson_get_number_type(&v) == CJSON_NUMBER_DOUBLE);
+    assert(cjson_get_number(&v) == 0.5);
+    cjson_free(&v);
+    
+    printf("✓ test_integer passed\n");
+}
+
 void test_string() {
     cjson_value v;
     cjson_init(&v);
@@ -111,15 +161,113 @@ void test_object() {
     printf("✓ test_object passed\n");
 }
 
+void test_find_object() {
+    cjson_value v;
+    char json[4096], key[16];
+    size_t pos;
+    
+    // Small objects are searched linearly; the first duplicate wins
+    cjson_init(&v);
+    assert(cjson_parse(&v, "{\"a\": 1, \"\": 2, \"a\": 3}") == CJSON_PARSE_OK);
+    assert(cjson_find_object_index(&v, "a", 1) == 0);
+    assert(cjson_get_number(cjson_find_object_value(&v, "", 0)) == 2.0);
+    assert(cjson_find_object_index(&v, "b", 1) == CJSON_KEY_NOT_EXIST);
+    assert(cjson_find_object_value(&v, "ab", 2) == NULL);
+    cjson_free(&v);
+    
+    // Large objects get a hash index on first lookup
+    pos = (size_t)sprintf(json, "{");
+    for (int i = 0; i < 200; i++)
+        pos += (size_t)sprintf(json + pos, "%s\"key%d\": %d", i ? ", " : "", i, i);
+    pos += (size_t)sprintf(json + pos, ", \"key7\": -1}");
+    cjson_init(&v);
+    assert(cjson_parse(&v, json) == CJSON_PARSE_OK);
+    for (int i = 0; i < 200; i++) {
+        int len = sprintf(key, "key%d", i);
+        assert(cjson_find_object_index(&v, key, (size_t)len) == (size_t)i);
+        assert(cjson_get_int64(cjson_find_object_value(&v, key, (size_t)len)) == i);
+    }
+    assert(cjson_find_object_value(&v, "key200", 6) == NULL);
+    assert(cjson_find_object_value(&v, "key1", 3) == NULL);
+    cjson_free(&v);
+    
+    // Arena documents carry the index from parse time
+    cjson_arena *arena = cjson_arena_new(0);
+    cjson_init(&v);
+    assert(cjson_parse_arena(&v, json, arena) == CJSON_PARSE_OK);
+    assert(cjson_get_int64(cjson_find_object_value(&v, "key199", 6)) == 199);
+    assert(cjson_find_object_index(&v, "key7", 4) == 7);
+    cjson_free(&v);
+    cjson_arena_free(arena);
+    
+    // Objects built by hand are indexed, and reindexed when they grow
+    cjson_init(&v);
+    cjson_set_object(&v, 40);
+    for (size_t i = 0; i < 40; i++) {
+        int len = sprintf(key, "k%zu", i);
+        v.u.o.m[i].key = (char *)malloc((size_t)len + 1);
+        memcpy(v.u.o.m[i].key, key, (size_t)len + 1);
+        v.u.o.m[i].len = (size_t)len;
+        cjson_init(&v.u.o.m[i].v);
+        cjson_set_number(&v.u.o.m[i].v, (double)i);
+        if (i >= 20)
+            v.u.o.size = i + 1;
+        if (i == 20)
+            assert(cjson_find_object_index(&v, "k20", 3) == 20);
+    }
+    assert(cjson_find_object_index(&v, "k39", 3) == 39);
+    assert(cjson_find_object_index(&v, "k40", 3) == CJSON_KEY_NOT_EXIST);
+    cjson_free(&v);
+    
+    printf("✓ test_find_object passed\n");
+}
+
+void test_parse_insitu() {
+    cjson_value v;
+    char buf[] = "{\"name\": \"John\", \"tags\": [\"a\\tb\", \"\\u00e9t\\u00e9\", \"\"]}";
+    cjson_init(&v);
+    
+    assert(cjson_parse_insitu(&v, buf, strlen(buf)) == CJSON_PARSE_OK);
+    assert(v.type == CJSON_OBJECT);
+    assert(v.u.o.size == 2);
+    
+    // Keys and escape-free strings point into the input buffer
+    assert(v.u.o.m[0].key >= buf && v.u.o.m[0].key < buf + sizeof(buf));
+    assert(strcmp(v.u.o.m[0].key, "name") == 0);
+    const char *name = cjson_get_string(&v.u.o.m[0].v);
+    assert(name >= buf && name < buf + sizeof(buf));
+    assert(strcmp(name, "John") == 0);
+    
+    // Escaped strings are decoded in place
+    cjson_value *tags = &v.u.o.m[1].v;
+    assert(cjson_get_array_size(tags) == 3);
+    assert(strcmp(cjson_get_string(cjson_get_array_element(tags, 0)), "a\tb") == 0);
+    assert(strcmp(cjson_get_string(cjson_get_array_element(tags, 1)), "\xC3\xA9t\xC3\xA9") == 0);
+    assert(cjson_get_string_length(cjson_get_array_element(tags, 1)) == 5);
+    assert(cjson_get_string_length(cjson_get_array_element(tags, 2)) == 0);
+    cjson_free(&v);
+    
+    // Errors are reported as with cjson_parse
+    char bad[] = "[\"ok\", \"bad\\x\"]";
+    cjson_init(&v);
+    assert(cjson_parse_insitu(&v, bad, strlen(bad)) == CJSON_INVALID_STRING_ESCAPE);
+    assert(v.type == CJSON_NULL);
+    
+    printf("✓ test_parse_insitu passed\n");
+}
+
 int main() {
     printf("Running basic JSON parsing tests...\n\n");
     
     test_null();
     test_boolean();
     test_number();
+    test_integer();
     test_string();
     test_array();
     test_object();
+    test_find_object();
+    test_parse_insitu();
     
     printf("\n✅ All basic tests passed!\n");
     return 0;
@@ -2,6 +2,8 @@
 #include <stdio.h>
 #include <string.h>
 #include <assert.h>
+#include <locale.h>
+#include <math.h>
 
 void test_error_handling() {
     cjson_value v;
@@ -132,6 +134,180 @@ void test_whitespace() {
     printf("✓ test_whitespace passed\n");
 }
 
+void test_length_delimited() {
+    cjson_value v;
+    
+    // Only the first len bytes are parsed
+    cjson_init(&v);
+    assert(cjson_parse_n(&v, "123456", 3) == CJSON_PARSE_OK);
+    assert(cjson_get_number(&v) == 123.0);
+    cjson_free(&v);
+    
+    cjson_init(&v);
+    assert(cjson_parse_n(&v, "[1, \"two\"]garbage", 10) == CJSON_PARSE_OK);
+    assert(cjson_get_array_size(&v) == 2);
+    assert(strcmp(cjson_get_string(cjson_get_array_element(&v, 1)), "two") == 0);
+    cjson_free(&v);
+    
+    // Tokens cut off by the length are errors
+    cjson_init(&v);
+    assert(cjson_parse_n(&v, "true", 3) == CJSON_INVALID_VALUE);
+    assert(cjson_parse_n(&v, "1e5", 2) == CJSON_INVALID_VALUE);
+    assert(cjson_parse_n(&v, "\"abc\"", 4) == CJSON_INVALID_STRING_MISS_QUOTATION);
+    assert(cjson_parse_n(&v, "\"\\u0041\"", 5) == CJSON_INVALID_UNICODE_HEX);
+    assert(cjson_parse_n(&v, "\"\\uD83D\\uDE00\"", 8) == CJSON_INVALID_UNICODE_SURROGATE);
+    assert(cjson_parse_n(&v, "[1, 2]", 5) == CJSON_MISS_COMMA_OR_SQUARE_BRACKET);
+    assert(cjson_parse_n(&v, "{\"a\": 1}", 7) == CJSON_MISS_COMMA_OR_CURLY_BRACKET);
+    assert(v.type == CJSON_NULL);
+    
+    // Embedded NULs are rejected
+    assert(cjson_parse_n(&v, "\"a\0b\"", 5) == CJSON_INVALID_STRING_CHAR);
+    assert(cjson_parse_n(&v, "1\0", 2) == CJSON_ROOT_NOT_SINGULAR);
+    assert(cjson_parse_n(&v, "[\0]", 3) == CJSON_INVALID_VALUE);
+    
+    // In-situ parsing does not need a terminator either
+    char buf[] = {'[', '"', 'x', '"', ']', '"'};
+    assert(cjson_parse_insitu(&v, buf, 5) == CJSON_PARSE_OK);
+    assert(strcmp(cjson_get_string(cjson_get_array_element(&v, 0)), "x") == 0);
+    cjson_free(&v);
+    
+    printf("✓ test_length_delimited passed\n");
+}
+
+void test_long_strings() {
+    cjson_value v;
+    char json[200], expect[200];
+    
+    // Escapes and invalid bytes at every offset around the vector widths
+    for (size_t pos = 0; pos < 70; pos++) {
+        size_t n = 0;
+        json[n++] = '"';
+        for (size_t i = 0; i < pos; i++) {
+            json[n++] = (char)('a' + i % 26);
+            expect[i] = (char)('a' + i % 26);
+        }
+        strcpy(json + n, "\\n\xC3\xA9tail\"");
+        strcpy(expect + pos, "\n\xC3\xA9tail");
+        
+        cjson_init(&v);
+        assert(cjson_parse(&v, json) == CJSON_PARSE_OK);
+        assert(cjson_get_string_length(&v) == pos + 7);
+        assert(memcmp(cjson_get_string(&v), expect, pos + 7) == 0);
+        cjson_free(&v);
+        
+        json[n] = '\x1F';
+        assert(cjson_parse(&v, json) == CJSON_INVALID_STRING_CHAR);
+        json[n] = '\0';
+        assert(cjson_parse(&v, json) == CJSON_INVALID_STRING_MISS_QUOTATION);
+        assert(v.type == CJSON_NULL);
+    }
+    
+    printf("✓ test_long_strings passed\n");
+}
+
+void test_structural_index() {
+    cjson_value v;
+    cjson_parse_options opts = {CJSON_PARSE_STRUCTURAL_INDEX, NULL, NULL, NULL, NULL};
+    char json[300];
+    
+    // Long indentation runs, escaped quotes and backslashes across 64-byte blocks
+    for (size_t pad = 0; pad < 70; pad++) {
+        size_t n = 0;
+        json[n++] = '[';
+        memset(json + n, ' ', pad);
+        n += pad;
+        n += sprintf(json + n, "\"a\\\\\",\n\t \"b\\\"] \",\r\n%*s-12.5e1 ,{ \"k\" :null}%*s]", (int)pad, "", (int)(70 - pad), "");
+        
+        cjson_init(&v);
+        assert(cjson_parse_ex(&v, json, n, &opts) == CJSON_PARSE_OK);
+        assert(cjson_get_array_size(&v) == 4);
+        assert(strcmp(cjson_get_string(cjson_get_array_element(&v, 0)), "a\\") == 0);
+        assert(strcmp(cjson_get_string(cjson_get_array_element(&v, 1)), "b\"] ") == 0);
+        assert(cjson_get_number(cjson_get_array_element(&v, 2)) == -125.0);
+        assert(cjson_get_array_element(&v, 3)->type == CJSON_OBJECT);
+        cjson_free(&v);
+    }
+    
+    // Errors match the plain parser
+    assert(cjson_parse_ex(&v, "1   2", 5, &opts) == CJSON_ROOT_NOT_SINGULAR);
+    assert(cjson_parse_ex(&v, "[1 x]", 5, &opts) == CJSON_MISS_COMMA_OR_SQUARE_BRACKET);
+    assert(cjson_parse_ex(&v, "[1,  ", 5, &opts) == CJSON_INVALID_VALUE);
+    assert(cjson_parse_ex(&v, "  \"a  ", 6, &opts) == CJSON_INVALID_STRING_MISS_QUOTATION);
+    assert(v.type == CJSON_NULL);
+    
+    printf("✓ test_structural_index passed\n");
+}
+
+static double parse_number_str(const char *json) {
+    cjson_value v;
+    cjson_init(&v);
+    assert(cjson_parse(&v, json) == CJSON_PARSE_OK);
+    double n = cjson_get_number(&v);
+    cjson_free(&v);
+    return n;
+}
+
+void test_number_conversion() {
+    cjson_value v;
+    
+    // Fast path: short mantissas with small exponents
+    assert(parse_number_str("0") == 0.0);
+    assert(signbit(parse_number_str("-0")));
+    assert(signbit(parse_number_str("-0.0e10")));
+    assert(parse_number_str("0.1") == 0.1);
+    assert(parse_number_str("-123.456e-2") == -1.23456);
+    assert(parse_number_str("1e22") == 1e22);
+    assert(parse_number_str("9007199254740992") == 9007199254740992.0);
+    assert(parse_number_str("0.000001") == 1e-6);
+    assert(parse_number_str("1E+2") == 100.0);
+    
+    // Slow path: long mantissas and large exponents
+    assert(parse_number_str("0.30000000000000004") == 0.30000000000000004);
+    assert(parse_number_str("9007199254740993") == 9007199254740992.0);
+    assert(parse_number_str("123456789012345678901234567890") == 123456789012345678901234567890.0);
+    assert(parse_number_str("1e23") == 1e23);
+    assert(parse_number_str("2.2250738585072014e-308") == 2.2250738585072014e-308);
+    assert(parse_number_str("4.9e-324") == 4.9e-324);
+    assert(parse_number_str("1e-400") == 0.0);
+    assert(parse_number_str("0e999999999") == 0.0);
+    
+    // Exact ties round to even, and any digit past a tie rounds up, however far out
+    assert(parse_number_str("9007199254740993") == 9007199254740992.0);
+    assert(parse_number_str("9007199254740995") == 9007199254740996.0);
+    assert(parse_number_str("9007199254740993.0000000000000000000000000000001") == 9007199254740994.0);
+    char digits[1200];
+    sprintf(digits, "9007199254740993.%0900d1", 0);
+    assert(parse_number_str(digits) == 9007199254740994.0);
+    sprintf(digits, "9007199254740993.%0900d", 0);
+    assert(parse_number_str(digits) == 9007199254740992.0);
+    assert(parse_number_str("2.4703282292062327e-324") == 0.0);
+    assert(parse_number_str("2.4703282292062328e-324") == 5e-324);
+    assert(parse_number_str("2.2250738585072011e-308") == 2.225073858507201e-308);
+    assert(parse_number_str("1.7976931348623158e308") == 1.7976931348623157e308);
+    assert(parse_number_str("0.000000000000000000000000000000000000000001e42") == 1.0);
+    
+    cjson_init(&v);
+    assert(cjson_parse(&v, "1e309") == CJSON_NUMBER_TOO_BIG);
+    assert(cjson_parse(&v, "-1.5e400") == CJSON_NUMBER_TOO_BIG);
+    assert(cjson_parse(&v, "1.7976931348623159e308") == CJSON_NUMBER_TOO_BIG);
+    assert(cjson_parse(&v, "1.") == CJSON_INVALID_VALUE);
+    assert(cjson_parse(&v, "01") == CJSON_ROOT_NOT_SINGULAR);
+    
+    // The result does not depend on LC_NUMERIC
+    const char *locales[] = {"de_DE.UTF-8", "de_DE.utf8", "fr_FR.UTF-8", "German_Germany.1252"};
+    for (size_t i = 0; i < sizeof(locales) / sizeof(locales[0]); i++) {
+        if (setlocale(LC_NUMERIC, locales[i]) != NULL) {
+            assert(parse_number_str("1.5") == 1.5);
+            assert(parse_number_str("0.30000000000000004") == 0.30000000000000004);
+            assert(parse_number_str("1.5e300") == 1.5e300);
+            setlocale(LC_NUMERIC, "C");
+            break;
+        }
+    }
+    
+    printf("✓ test_number_conversion passed\n");
+}
+
 int main() {
     printf("Running edge case tests...\n\n");
     
@@ -140,6 +316,10 @@ int main() {
     test_unicode();
     test_nested_structures();
     test_whitespace();
+    test_length_delimited();
+    test_long_strings();
+    test_structural_index();
+    test_number_conversion();
     
     printf("\n✅ All edge case tests passed!\n");
     return 0;
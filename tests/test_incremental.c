@@ -0,0 +1,130 @@
+#include "../CJson.h"
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <stdlib.h>
+
+static const char *document =
+    " {\"name\": \"J\\u00f6rg \\\"JJ\\\"\", \"id\": 12345678901234, \"ratio\": -1.25e-3,\n"
+    "  \"tags\": [\"a\", \"\", \"\\\\\"], \"ok\": true, \"none\": null, \"no\": false,\n"
+    "  \"nested\": {\"empty\": {}, \"list\": [[], [0], [1, [2, [3]]]]}} ";
+
+// Feeds json in chunks of the given size and returns the finish result
+static int feed_chunks(cjson_parser *p, const char *json, size_t chunk, cjson_value *v) {
+    size_t len = strlen(json);
+    for (size_t i = 0; i < len; i += chunk) {
+        int ret = cjson_parser_feed(p, json + i, (len - i < chunk) ? len - i : chunk);
+        assert(ret == CJSON_PARSE_NEED_MORE || ret == CJSON_PARSE_OK || ret == cjson_parser_feed(p, "", 0));
+    }
+    return cjson_parser_finish(p, v);
+}
+
+void test_incremental_chunks() {
+    cjson_parser *p = cjson_parser_new(NULL);
+    cjson_value expected, v;
+    char *want, *got;
+    
+    cjson_init(&expected);
+    assert(cjson_parse(&expected, document) == CJSON_PARSE_OK);
+    want = cjson_stringify(&expected, NULL);
+    
+    // Every chunk size, including one byte at a time; the parser is reused
+    for (size_t chunk = 1; chunk <= strlen(document); chunk++) {
+        assert(feed_chunks(p, document, chunk, &v) == CJSON_PARSE_OK);
+        got = cjson_stringify(&v, NULL);
+        assert(strcmp(got, want) == 0);
+        free(got);
+        cjson_free(&v);
+    }
+    
+    free(want);
+    cjson_free(&expected);
+    cjson_parser_free(p);
+    printf("✓ test_incremental_chunks passed\n");
+}
+
+void test_incremental_status() {
+    cjson_parser *p = cjson_parser_new(NULL);
+    cjson_value v;
+    
+    // A chunk ending inside a string asks for more instead of failing
+    assert(cjson_parser_feed(p, "[\"abc", 5) == CJSON_PARSE_NEED_MORE);
+    assert(cjson_parser_feed(p, "\\", 1) == CJSON_PARSE_NEED_MORE);
+    assert(cjson_parser_feed(p, "\"def\"", 5) == CJSON_PARSE_NEED_MORE);
+    assert(cjson_parser_feed(p, "]", 1) == CJSON_PARSE_OK);
+    assert(cjson_parser_feed(p, " \n", 2) == CJSON_PARSE_OK);
+    assert(cjson_parser_finish(p, &v) == CJSON_PARSE_OK);
+    assert(strcmp(cjson_get_string(cjson_get_array_element(&v, 0)), "abc\"def") == 0);
+    cjson_free(&v);
+    
+    // A root number is only complete at the end of the input
+    assert(cjson_parser_feed(p, "12", 2) == CJSON_PARSE_NEED_MORE);
+    assert(cjson_parser_feed(p, "34", 2) == CJSON_PARSE_NEED_MORE);
+    assert(cjson_parser_finish(p, &v) == CJSON_PARSE_OK);
+    assert(cjson_get_int64(&v) == 1234);
+    
+    // Errors are sticky until finish, which resets the parser
+    assert(cjson_parser_feed(p, "[1 2", 4) == CJSON_MISS_COMMA_OR_SQUARE_BRACKET);
+    assert(cjson_parser_feed(p, "]", 1) == CJSON_MISS_COMMA_OR_SQUARE_BRACKET);
+    assert(cjson_parser_finish(p, &v) == CJSON_MISS_COMMA_OR_SQUARE_BRACKET);
+    assert(v.type == CJSON_NULL);
+    assert(cjson_parser_feed(p, "{\"k\": ", 6) == CJSON_PARSE_NEED_MORE);
+    assert(cjson_parser_finish(p, &v) == CJSON_INVALID_VALUE);
+    assert(cjson_parser_feed(p, "{}", 2) == CJSON_PARSE_OK);
+    assert(cjson_parser_feed(p, "{}", 2) == CJSON_ROOT_NOT_SINGULAR);
+    assert(cjson_parser_finish(p, &v) == CJSON_ROOT_NOT_SINGULAR);
+    
+    cjson_parser_free(p);
+    printf("✓ test_incremental_status passed\n");
+}
+
+void test_incremental_errors() {
+    // Split anywhere, invalid input fails with the same code as cjson_parse
+    const char *cases[] = {"", " ", "[", "{", "{\"a\"", "{\"a\":", "[1,", "[1 2]", "{\"a\" 1}", "{1: 2}", "\"abc",
+                           "\"\\x\"", "\"\\uD800\"", "1e400", "01", "[] x", "tru", "truex", "1.5.3", "[1.5.3]",
+                           "{\"a\": 1.5.3}", "[\"a\"b]", "{\"a\": [}", "-", "[-]", "nul", "\"a\tb\""};
+    cjson_parser *p = cjson_parser_new(NULL);
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        cjson_value v;
+        cjson_init(&v);
+        int expected = cjson_parse(&v, cases[i]);
+        assert(expected != CJSON_PARSE_OK);
+        cjson_free(&v);
+        for (size_t chunk = 1; chunk <= strlen(cases[i]) + 1; chunk++) {
+            assert(feed_chunks(p, cases[i], chunk, &v) == expected);
+            assert(v.type == CJSON_NULL);
+        }
+    }
+    cjson_parser_free(p);
+    printf("✓ test_incremental_errors passed\n");
+}
+
+void test_incremental_arena() {
+    cjson_arena *arena = cjson_arena_new(0);
+    cjson_parse_options opts = {0, NULL, NULL, NULL, NULL};
+    opts.arena = arena;
+    cjson_parser *p = cjson_parser_new(&opts);
+    cjson_value v;
+    
+    assert(feed_chunks(p, document, 7, &v) == CJSON_PARSE_OK);
+    assert(strcmp(cjson_get_string(cjson_find_object_value(&v, "name", 4)), "J\xC3\xB6rg \"JJ\"") == 0);
+    cjson_free(&v);
+    
+    // Partial documents in the arena are dropped with the parser
+    assert(cjson_parser_feed(p, "{\"a\": [\"x\", {\"b\": ", 18) == CJSON_PARSE_NEED_MORE);
+    cjson_parser_free(p);
+    cjson_arena_free(arena);
+    printf("✓ test_incremental_arena passed\n");
+}
+
+int main() {
+    printf("Running incremental parser tests...\n\n");
+    
+    test_incremental_chunks();
+    test_incremental_status();
+    test_incremental_errors();
+    test_incremental_arena();
+    
+    printf("\n✅ All incremental parser tests passed!\n");
+    return 0;
+}
@@ -0,0 +1,145 @@
+#include "../CJson.h"
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <stdlib.h>
+
+static int lazy_parse(cjson_value *v, const char *json) {
+    cjson_parse_options opts = {CJSON_PARSE_LAZY, NULL, NULL, NULL, NULL};
+    cjson_init(v);
+    return cjson_parse_ex(v, json, strlen(json), &opts);
+}
+
+void test_lazy_access() {
+    const char *json = "{ \"skip\": [1, {\"x\": \"]}\\\"[{\"}, [[]]],\n"
+                       "  \"user\": {\"name\": \"J\\u00f6rg\", \"ids\": [10, 20, 30]},\n"
+                       "  \"empty\": {}, \"none\": [], \"n\": -1.5e3 }";
+    cjson_value v;
+    assert(lazy_parse(&v, json) == CJSON_PARSE_OK);
+    assert(v.type == CJSON_OBJECT);
+    
+    // Getters decode a level the first time they reach it
+    assert(cjson_get_object_size(&v) == 5);
+    assert(strcmp(cjson_get_object_key(&v, 1), "user") == 0);
+    cjson_value *user = cjson_find_object_value(&v, "user", 4);
+    assert(user != NULL && user->type == CJSON_OBJECT);
+    assert(strcmp(cjson_get_string(cjson_find_object_value(user, "name", 4)), "J\xC3\xB6rg") == 0);
+    cjson_value *ids = cjson_find_object_value(user, "ids", 3);
+    assert(cjson_get_array_size(ids) == 3);
+    assert(cjson_get_int64(cjson_get_array_element(ids, 2)) == 30);
+    assert(cjson_get_number(cjson_find_object_value(&v, "n", 1)) == -1500.0);
+    assert(cjson_get_object_size(cjson_find_object_value(&v, "empty", 5)) == 0);
+    assert(cjson_get_array_size(cjson_get_object_value(&v, 3)) == 0);
+    
+    // Brackets and escaped quotes inside strings do not confuse the skip
+    cjson_value *skip = cjson_find_object_value(&v, "skip", 4);
+    assert(cjson_get_array_size(skip) == 3);
+    cjson_value *x = cjson_find_object_value(cjson_get_array_element(skip, 1), "x", 1);
+    assert(strcmp(cjson_get_string(x), "]}\"[{") == 0);
+    
+    // Freeing a partly decoded document releases only what was decoded
+    cjson_free(&v);
+    assert(v.type == CJSON_NULL);
+    
+    // Untouched documents need nothing freed, and scalars are parsed as usual
+    assert(lazy_parse(&v, "[[1, 2], {\"a\": [3]}]") == CJSON_PARSE_OK);
+    cjson_free(&v);
+    assert(lazy_parse(&v, " \"text\" ") == CJSON_PARSE_OK);
+    assert(strcmp(cjson_get_string(&v), "text") == 0);
+    cjson_free(&v);
+    
+    printf("✓ test_lazy_access passed\n");
+}
+
+void test_lazy_stringify() {
+    const char *json = "[ {\"a\" : [1.0, true, null, \"\\u0041\"]}, [ ], {\"b\": {\"c\": 2}} ]";
+    cjson_value eager, lazy;
+    cjson_init(&eager);
+    assert(cjson_parse(&eager, json) == CJSON_PARSE_OK);
+    char *expected = cjson_stringify(&eager, NULL);
+    
+    // Whole-document operations decode everything they walk
+    assert(lazy_parse(&lazy, json) == CJSON_PARSE_OK);
+    assert(cjson_stringify_size(&lazy) == strlen(expected));
+    cjson_free(&lazy);
+    assert(lazy_parse(&lazy, json) == CJSON_PARSE_OK);
+    char *out = cjson_stringify(&lazy, NULL);
+    assert(strcmp(out, expected) == 0);
+    free(out);
+    cjson_free(&lazy);
+    assert(lazy_parse(&lazy, json) == CJSON_PARSE_OK);
+    out = cjson_stringify_ex(&lazy, CJSON_STRINGIFY_SORT_KEYS, NULL);
+    assert(strcmp(out, expected) == 0);
+    free(out);
+    
+    // Replacing a lazy subtree frees nothing that was never decoded
+    cjson_free(&lazy);
+    assert(lazy_parse(&lazy, json) == CJSON_PARSE_OK);
+    cjson_set_string(cjson_get_array_element(&lazy, 2), "gone", 4);
+    out = cjson_stringify(&lazy, NULL);
+    assert(strcmp(out, "[{\"a\":[1,true,null,\"A\"]},[],\"gone\"]") == 0);
+    free(out);
+    cjson_free(&lazy);
+    
+    free(expected);
+    cjson_free(&eager);
+    
+    // Containers spanning many 64-byte blocks, with escapes and brackets at every offset
+    char *doc = (char *)malloc(64 * 1024);
+    size_t n = 0;
+    n += sprintf(doc + n, "[");
+    for (int i = 0; i < 300; i++)
+        n += sprintf(doc + n, "%s{\"k%d\": [\"%.*s\\\\\\\"]}\", {\"\\\\\": \"[{\"}, [[%d]]]}", i ? ", " : "", i, i % 67, "................................................................................", i);
+    n += sprintf(doc + n, ", \"last\"]");
+    cjson_init(&eager);
+    assert(cjson_parse(&eager, doc) == CJSON_PARSE_OK);
+    expected = cjson_stringify(&eager, NULL);
+    assert(lazy_parse(&lazy, doc) == CJSON_PARSE_OK);
+    assert(cjson_get_array_size(&lazy) == 301);
+    assert(strcmp(cjson_get_string(cjson_get_array_element(&lazy, 300)), "last") == 0);
+    cjson_value *k = cjson_find_object_value(cjson_get_array_element(&lazy, 250), "k250", 4);
+    assert(cjson_get_int64(cjson_get_array_element(cjson_get_array_element(cjson_get_array_element(k, 2), 0), 0)) == 250);
+    out = cjson_stringify(&lazy, NULL);
+    assert(strcmp(out, expected) == 0);
+    free(out);
+    free(expected);
+    cjson_free(&lazy);
+    cjson_free(&eager);
+    free(doc);
+    
+    printf("✓ test_lazy_stringify passed\n");
+}
+
+void test_lazy_errors() {
+    // The whole input is validated up front, nested errors included
+    const char *bad[] = {
+        "[1, {\"a\": [tru]}]",
+        "{\"a\": {\"b\": \"\\x\"}}",
+        "[[1], [2,]]",
+        "{\"a\": [1] \"b\": 2}",
+        "[{}] x",
+        "[\"unterminated]"
+    };
+    for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++) {
+        cjson_value eager, lazy;
+        cjson_init(&eager);
+        int expected = cjson_parse(&eager, bad[i]);
+        assert(expected != CJSON_PARSE_OK);
+        assert(lazy_parse(&lazy, bad[i]) == expected);
+        assert(lazy.type == CJSON_NULL);
+        cjson_free(&eager); // a root followed by garbage is still returned
+    }
+    
+    printf("✓ test_lazy_errors passed\n");
+}
+
+int main() {
+    printf("Running lazy parsing tests...\n\n");
+    
+    test_lazy_access();
+    test_lazy_stringify();
+    test_lazy_errors();
+    
+    printf("\n✅ All lazy parsing tests passed!\n");
+    return 0;
+}
@@ -1,6 +1,7 @@
 #include "../CJson.h"
 #include <stdio.h>
 #include <string.h>
+#include <stdlib.h>
 #include <assert.h>
 
 void test_memory_cleanup() {
@@ -112,12 +113,593 @@ void test_multiple_operations() {
     printf("✓ test_multiple_operations passed\n");
 }
 
+void test_arena_parse() {
+    cjson_arena *arena = cjson_arena_new(0);
+    cjson_value v;
+    
+    // Parse a nested document entirely into the arena
+    cjson_init(&v);
+    assert(cjson_parse_arena(&v, "{\"users\": [{\"name\": \"John\"}, {\"name\": \"Jane\"}], \"count\": 2}", arena) == CJSON_PARSE_OK);
+    assert(v.type == CJSON_OBJECT);
+    assert(v.u.o.size == 2);
+    assert(strcmp(cjson_get_object_key(&v, 0), "users") == 0);
+    cjson_value *users = &v.u.o.m[0].v;
+    assert(cjson_get_array_size(users) == 2);
+    assert(strcmp(cjson_get_string(&cjson_get_array_element(users, 1)->u.o.m[0].v), "Jane") == 0);
+    assert(cjson_get_number(&v.u.o.m[1].v) == 2.0);
+    
+    // Overwriting an arena node must not free arena memory
+    cjson_set_string(cjson_get_array_element(users, 0), "replaced", 8);
+    assert(strcmp(cjson_get_string(cjson_get_array_element(users, 0)), "replaced") == 0);
+    cjson_free(&v); // Frees only what was allocated outside the arena
+    
+    // Failed parses leave a null value behind
+    cjson_init(&v);
+    assert(cjson_parse_arena(&v, "[\"a\", {\"b\": 1,}]", arena) == CJSON_MISS_KEY);
+    assert(v.type == CJSON_NULL);
+    
+    // Reset releases every document at once and keeps a block for reuse
+    cjson_arena_reset(arena);
+    cjson_init(&v);
+    assert(cjson_parse_arena(&v, "[\"hello\", 1, true, null, {}]", arena) == CJSON_PARSE_OK);
+    assert(cjson_get_array_size(&v) == 5);
+    assert(strcmp(cjson_get_string(cjson_get_array_element(&v, 0)), "hello") == 0);
+    
+    // Small block size forces oversized and chained blocks
+    cjson_arena *small = cjson_arena_new(64);
+    cjson_init(&v);
+    assert(cjson_parse_arena(&v, "[\"a string that is definitely longer than sixteen bytes\", [1, 2, 3, 4, 5, 6, 7, 8]]", small) == CJSON_PARSE_OK);
+    assert(cjson_get_string_length(cjson_get_array_element(&v, 0)) == 53);
+    assert(cjson_get_array_size(cjson_get_array_element(&v, 1)) == 8);
+    cjson_arena_free(small);
+    
+    cjson_arena_free(arena);
+    printf("✓ test_arena_parse passed\n");
+}
+
+void test_context_reuse() {
+    cjson_context *ctx = cjson_context_new();
+    cjson_parse_options opts = {0, NULL, NULL, NULL, NULL};
+    opts.context = ctx;
+    cjson_value v;
+    const char *docs[] = {"{\"name\": \"a string long enough to need the stack\", \"list\": [1, 2, 3]}",
+                          "true", "[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[\"deep\"]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]", "\"\""};
+    
+    // The same stack serves parses and stringifications in turn
+    for (int round = 0; round < 3; round++) {
+        for (size_t i = 0; i < sizeof(docs) / sizeof(docs[0]); i++) {
+            size_t len;
+            cjson_init(&v);
+            assert(cjson_parse_ex(&v, docs[i], strlen(docs[i]), &opts) == CJSON_PARSE_OK);
+            const char *out = cjson_context_stringify(ctx, &v, &len);
+            char *expected = cjson_stringify(&v, NULL);
+            assert(strcmp(out, expected) == 0 && strlen(out) == len);
+            free(expected);
+            cjson_free(&v);
+        }
+    }
+    
+    // A large document grows the stack
+    size_t n = 100000;
+    char *big = (char *)malloc(n * 2 + 2);
+    big[0] = '[';
+    for (size_t i = 0; i < n; i++) {
+        big[1 + 2 * i] = '7';
+        big[2 + 2 * i] = (i + 1 < n) ? ',' : ']';
+    }
+    big[n * 2 + 1] = '\0';
+    cjson_init(&v);
+    assert(cjson_parse_ex(&v, big, strlen(big), &opts) == CJSON_PARSE_OK);
+    assert(cjson_get_array_size(&v) == n);
+    const char *text = cjson_context_stringify(ctx, &v, NULL);
+    assert(strcmp(text, big) == 0);
+    cjson_free(&v);
+    free(big);
+
+    // Reset keeps the grown stack, trim gives it back
+    cjson_context_reset(ctx);
+    assert(text[0] == '\0');
+    cjson_init(&v);
+    assert(cjson_parse_ex(&v, docs[0], strlen(docs[0]), &opts) == CJSON_PARSE_OK);
+    assert(cjson_context_stringify(ctx, &v, NULL) == text);
+    cjson_context_trim(ctx);
+    assert(strncmp(cjson_context_stringify(ctx, &v, NULL), "{\"name\":", 8) == 0);
+    cjson_free(&v);
+    
+    cjson_context_free(ctx);
+    printf("✓ test_context_reuse passed\n");
+}
+
+void test_value_layout() {
+    cjson_value v;
+    
+#ifdef CJSON_COMPACT
+    assert(sizeof(cjson_value) == 16);
+    assert(sizeof(cjson_member) == 32);
+#endif
+    
+    // Capacities survive in either layout, including the indexed object size
+    cjson_init(&v);
+    cjson_set_object(&v, 20);
+    assert(v.type == CJSON_OBJECT && v.u.o.size == 0);
+    cjson_free(&v);
+    cjson_init(&v);
+    cjson_set_array(&v, 0);
+    assert(cjson_get_array_capacity(&v) == 0 && cjson_get_array_size(&v) == 0);
+    cjson_free(&v);
+    
+    // Parsed containers of every size, in the heap and in an arena
+    cjson_arena *arena = cjson_arena_new(0);
+    const char *doc = "{\"a\":[1,[],{}],\"b\":\"x\",\"c\":{\"0\":0,\"1\":1,\"2\":2,\"3\":3,\"4\":4,\"5\":5,\"6\":6,"
+                      "\"7\":7,\"8\":8,\"9\":9,\"10\":10,\"11\":11,\"12\":12,\"13\":13,\"14\":14,\"15\":15,\"16\":16}}";
+    for (int i = 0; i < 2; i++) {
+        cjson_init(&v);
+        int ret = i ? cjson_parse_arena(&v, doc, arena) : cjson_parse(&v, doc);
+        assert(ret == CJSON_PARSE_OK);
+        cjson_value *a = cjson_find_object_value(&v, "a", 1);
+        assert(cjson_get_array_size(a) == 3 && cjson_get_array_capacity(a) == 3);
+        cjson_value *c = cjson_find_object_value(&v, "c", 1);
+        assert(c->u.o.size == 17 && cjson_get_number(cjson_find_object_value(c, "16", 2)) == 16.0);
+        char *out = cjson_stringify(&v, NULL);
+        assert(strcmp(out, doc) == 0);
+        free(out);
+        cjson_free(&v);
+    }
+    cjson_arena_free(arena);
+    
+    printf("✓ test_value_layout passed\n");
+}
+
+void test_short_strings() {
+    cjson_value v;
+    char str[40], doc[160];
+    
+    // Every length on both sides of the inline limits round-trips
+    for (size_t len = 0; len < sizeof(str); len++) {
+        memset(str, 'a' + (int)(len % 26), len);
+        str[len] = '\0';
+        cjson_init(&v);
+        cjson_set_string(&v, str, len);
+        assert(cjson_get_string_length(&v) == len && strcmp(cjson_get_string(&v), str) == 0);
+        cjson_free(&v);
+        
+        snprintf(doc, sizeof(doc), "{\"%s\":\"%s\",\"k\":[\"%s\"]}", str, str, str);
+        for (int arena = 0; arena < 2; arena++) {
+            cjson_arena *a = arena ? cjson_arena_new(0) : NULL;
+            cjson_init(&v);
+            assert((a ? cjson_parse_arena(&v, doc, a) : cjson_parse(&v, doc)) == CJSON_PARSE_OK);
+            assert(cjson_get_object_key_length(&v, 0) == len && strcmp(cjson_get_object_key(&v, 0), str) == 0);
+            assert(strcmp(cjson_get_string(&v.u.o.m[0].v), str) == 0);
+            cjson_value *elem = cjson_get_array_element(cjson_find_object_value(&v, "k", 1), 0);
+            assert(cjson_get_string_length(elem) == len && strcmp(cjson_get_string(elem), str) == 0);
+            assert(cjson_find_object_value(&v, str, len) == &v.u.o.m[0].v);
+            char *out = cjson_stringify(&v, NULL);
+            assert(strcmp(out, doc) == 0);
+            free(out);
+            
+            // Replacing values keeps the inline key intact
+            cjson_set_string(&v.u.o.m[0].v, doc, strlen(doc));
+            cjson_free(&v.u.o.m[0].v);
+            cjson_set_int64(&v.u.o.m[0].v, 7);
+            assert(strcmp(cjson_get_object_key(&v, 0), str) == 0);
+            cjson_free(&v);
+            cjson_arena_free(a);
+        }
+    }
+    
+    // Parsed empty strings read back as "" rather than NULL
+    cjson_init(&v);
+    assert(cjson_parse(&v, "\"\"") == CJSON_PARSE_OK);
+    assert(cjson_get_string(&v) != NULL && cjson_get_string(&v)[0] == '\0');
+    cjson_free(&v);
+    
+    printf("✓ test_short_strings passed\n");
+}
+
+void test_key_table() {
+    cjson_key_table *keys = cjson_key_table_new();
+    cjson_parse_options opts = {0, NULL, NULL, NULL, NULL};
+    cjson_value a, b;
+    char doc[64];
+    opts.keys = keys;
+    
+    // Equal keys of separate documents share one string owned by the table
+    const char *rec = "{\"timestamp\":1,\"user_id\":\"x\",\"a_rather_long_key_name\":{\"id\":2}}";
+    cjson_init(&a);
+    cjson_init(&b);
+    assert(cjson_parse_ex(&a, rec, strlen(rec), &opts) == CJSON_PARSE_OK);
+    assert(cjson_parse_ex(&b, rec, strlen(rec), &opts) == CJSON_PARSE_OK);
+    assert(cjson_key_table_size(keys) == 4);
+    for (size_t i = 0; i < 3; i++)
+        assert(cjson_get_object_key(&a, i) == cjson_get_object_key(&b, i));
+    assert(a.u.o.m[1].key == cjson_key_table_intern(keys, "user_id", 7));
+    assert(cjson_key_table_size(keys) == 4);
+    
+    // Lookups work with interned and plain keys alike
+    assert(cjson_find_object_index(&a, cjson_key_table_intern(keys, "user_id", 7), 7) == 1);
+    assert(cjson_find_object_index(&b, "timestamp", 9) == 0);
+    char *out = cjson_stringify(&b, NULL);
+    assert(strcmp(out, rec) == 0);
+    free(out);
+    cjson_free(&a);
+    cjson_free(&b);
+    
+    // The table grows past its initial size, and the push parser shares it
+    for (int i = 0; i < 200; i++) {
+        snprintf(doc, sizeof(doc), "{\"key%d\":[{\"\":%d}]}", i, i);
+        cjson_init(&a);
+        assert(cjson_parse_ex(&a, doc, strlen(doc), &opts) == CJSON_PARSE_OK);
+        cjson_free(&a);
+    }
+    assert(cjson_key_table_size(keys) == 205);
+    cjson_parser *p = cjson_parser_new(&opts);
+    assert(cjson_parser_feed(p, "{\"key1", 6) == CJSON_PARSE_NEED_MORE);
+    assert(cjson_parser_feed(p, "99\":null}", 9) == CJSON_PARSE_OK);
+    assert(cjson_parser_finish(p, &a) == CJSON_PARSE_OK);
+    assert(a.u.o.m[0].key == cjson_key_table_intern(keys, "key199", 6));
+    cjson_free(&a);
+    cjson_parser_free(p);
+    assert(cjson_key_table_size(keys) == 205);
+    
+    cjson_key_table_free(keys);
+    printf("✓ test_key_table passed\n");
+}
+
+void test_array_mutation() {
+    cjson_value v, e;
+    char *out;
+    
+    // Pushing grows geometrically and moves elements in without copying them
+    cjson_init(&v);
+    cjson_set_array(&v, 0);
+    for (int i = 0; i < 1000; i++) {
+        cjson_init(&e);
+        cjson_set_int64(&e, i);
+        assert(cjson_get_int64(cjson_array_push(&v, &e)) == i);
+        assert(e.type == CJSON_NULL);
+    }
+    assert(cjson_get_array_size(&v) == 1000);
+    assert(cjson_get_array_capacity(&v) >= 1000 && cjson_get_array_capacity(&v) < 2000);
+    cjson_init(&e);
+    cjson_set_string(&e, "a string too long to be stored inline", 37);
+    const char *s = cjson_get_string(&e);
+    assert(cjson_get_string(cjson_array_push(&v, &e)) == s);
+    cjson_free(&e);
+    
+    // Insert, erase and shrink
+    cjson_array_erase(&v, 10, 990);
+    assert(cjson_get_array_size(&v) == 11);
+    assert(cjson_get_string(cjson_get_array_element(&v, 10)) == s);
+    cjson_array_erase(&v, 3, 8);
+    cjson_array_insert(&v, 0, NULL);
+    cjson_init(&e);
+    cjson_set_boolean(&e, 1);
+    cjson_array_insert(&v, 2, &e);
+    cjson_array_push(&v, NULL);
+    cjson_array_shrink_to_fit(&v);
+    assert(cjson_get_array_capacity(&v) == 6);
+    out = cjson_stringify(&v, NULL);
+    assert(strcmp(out, "[null,0,true,1,2,null]") == 0);
+    free(out);
+    cjson_array_erase(&v, 0, 6);
+    cjson_array_shrink_to_fit(&v);
+    assert(cjson_get_array_capacity(&v) == 0);
+    cjson_array_reserve(&v, 50);
+    assert(cjson_get_array_capacity(&v) == 50);
+    cjson_array_push(&v, NULL);
+    assert(cjson_get_array_capacity(&v) == 50);
+    cjson_free(&v);
+    
+    // An element of the array itself is taken out before the buffer moves or shifts
+    for (int spare = 0; spare < 2; spare++) {
+        cjson_init(&v);
+        assert(cjson_parse(&v, "[0, null, \"a string too long to be stored inline\"]") == CJSON_PARSE_OK);
+        if (spare)
+            cjson_array_reserve(&v, 8);
+        assert(cjson_get_array_capacity(&v) == (spare ? 8u : 3u));
+        cjson_array_insert(&v, 0, cjson_get_array_element(&v, 2));
+        out = cjson_stringify(&v, NULL);
+        assert(strcmp(out, "[\"a string too long to be stored inline\",0,null,null]") == 0);
+        free(out);
+        cjson_array_shrink_to_fit(&v);
+        cjson_array_push(&v, cjson_get_array_element(&v, 0));
+        out = cjson_stringify(&v, NULL);
+        assert(strcmp(out, "[null,0,null,null,\"a string too long to be stored inline\"]") == 0);
+        free(out);
+        if (spare)
+            cjson_array_reserve(&v, 8);
+        cjson_array_insert(&v, 0, cjson_get_array_element(&v, 1));
+        out = cjson_stringify(&v, NULL);
+        assert(strcmp(out, "[0,null,null,null,null,\"a string too long to be stored inline\"]") == 0);
+        free(out);
+        cjson_free(&v);
+    }
+    
+    // Arena arrays move to the heap when they grow; their elements stay put
+    cjson_arena *arena = cjson_arena_new(0);
+    cjson_init(&v);
+    assert(cjson_parse_arena(&v, "[\"a string that lives in the arena\", [1]]", arena) == CJSON_PARSE_OK);
+    cjson_init(&e);
+    cjson_set_string(&e, "heap", 4);
+    cjson_array_push(&v, &e);
+    cjson_array_push(cjson_get_array_element(&v, 1), NULL);
+    cjson_array_erase(&v, 0, 1);
+    out = cjson_stringify(&v, NULL);
+    assert(strcmp(out, "[[1,null],\"heap\"]") == 0);
+    free(out);
+    cjson_free(&v);
+    cjson_arena_free(arena);
+    
+    printf("✓ test_array_mutation passed\n");
+}
+
+void test_object_mutation() {
+    cjson_value v, e;
+    char key[32];
+    char *out;
+    
+    // Appending keeps the hash index current as the object grows
+    cjson_init(&v);
+    cjson_set_object(&v, 0);
+    for (int i = 0; i < 300; i++) {
+        int len = sprintf(key, i % 2 ? "k%d" : "a much longer key number %d", i);
+        cjson_init(&e);
+        cjson_set_int64(&e, i);
+        cjson_object_set(&v, key, (size_t)len, &e);
+        assert(cjson_find_object_index(&v, key, (size_t)len) == (size_t)i);
+    }
+    assert(cjson_get_object_size(&v) == 300);
+    
+    // Setting an existing key replaces its value in place
+    cjson_init(&e);
+    cjson_set_string(&e, "replaced", 8);
+    cjson_object_set(&v, "k7", 2, &e);
+    assert(cjson_get_object_size(&v) == 300);
+    assert(strcmp(cjson_get_string(cjson_get_object_value(&v, 7)), "replaced") == 0);
+    assert(cjson_object_set(&v, "k9", 2, NULL)->type == CJSON_NULL);
+    
+    // Removing keeps order and renumbers the index
+    for (int i = 0; i < 300; i += 3) {
+        int len = sprintf(key, i % 2 ? "k%d" : "a much longer key number %d", i);
+        assert(cjson_object_remove(&v, key, (size_t)len) == 1);
+    }
+    assert(cjson_object_remove(&v, "k0", 2) == 0);
+    assert(cjson_get_object_size(&v) == 200);
+    for (int i = 0; i < 300; i++) {
+        int len = sprintf(key, i % 2 ? "k%d" : "a much longer key number %d", i);
+        size_t index = cjson_find_object_index(&v, key, (size_t)len);
+        assert(i % 3 == 0 ? index == CJSON_KEY_NOT_EXIST : index == (size_t)(i - i / 3 - 1));
+    }
+    cjson_free(&v);
+    
+    // Values move between documents; the source member keeps its key
+    cjson_value src;
+    cjson_init(&src);
+    assert(cjson_parse(&src, "{\"cached\": {\"x\": [1, 2]}, \"y\": 1}") == CJSON_PARSE_OK);
+    cjson_init(&v);
+    cjson_set_object(&v, 1);
+    cjson_object_reserve(&v, 20);
+    cjson_object_set(&v, "fragment", 8, cjson_find_object_value(&src, "cached", 6));
+    out = cjson_stringify(&v, NULL);
+    assert(strcmp(out, "{\"fragment\":{\"x\":[1,2]}}") == 0);
+    free(out);
+    out = cjson_stringify(&src, NULL);
+    assert(strcmp(out, "{\"cached\":null,\"y\":1}") == 0);
+    free(out);
+    cjson_free(&src);
+    cjson_free(&v);
+    
+    // A member of the object itself is taken out before the full buffer moves,
+    // in small objects and in indexed ones
+    for (int n = 4; n <= 16; n += 12) {
+        cjson_init(&v);
+        cjson_set_object(&v, 0);
+        for (int i = 0; i < n; i++) {
+            int len = sprintf(key, "m%d", i);
+            cjson_init(&e);
+            cjson_set_string(&e, "a string too long to be stored inline", 37);
+            cjson_object_set(&v, key, (size_t)len, &e);
+        }
+        assert(cjson_find_object_index(&v, "m1", 2) == 1);
+        cjson_object_set(&v, "added", 5, cjson_find_object_value(&v, "m1", 2));
+        assert(cjson_get_object_size(&v) == (size_t)n + 1);
+        assert(cjson_find_object_value(&v, "m1", 2)->type == CJSON_NULL);
+        assert(strcmp(cjson_get_string(cjson_find_object_value(&v, "added", 5)), "a string too long to be stored inline") == 0);
+        assert(cjson_find_object_index(&v, "added", 5) == (size_t)n);
+        cjson_object_set(&v, "m0", 2, cjson_find_object_value(&v, "m0", 2));
+        cjson_object_set(&v, "m1", 2, cjson_find_object_value(&v, "added", 5));
+        assert(strcmp(cjson_get_string(cjson_find_object_value(&v, "m0", 2)), "a string too long to be stored inline") == 0);
+        assert(cjson_get_string_length(cjson_find_object_value(&v, "m1", 2)) == 37);
+        cjson_free(&v);
+    }
+    
+    // Arena objects, indexed at parse time, can be edited too
+    cjson_arena *arena = cjson_arena_new(0);
+    char json[1024];
+    size_t pos = (size_t)sprintf(json, "{");
+    for (int i = 0; i < 20; i++)
+        pos += (size_t)sprintf(json + pos, "%s\"key%d\": %d", i ? ", " : "", i, i);
+    sprintf(json + pos, "}");
+    cjson_init(&v);
+    assert(cjson_parse_arena(&v, json, arena) == CJSON_PARSE_OK);
+    assert(cjson_object_remove(&v, "key3", 4) == 1);
+    assert(cjson_find_object_index(&v, "key19", 5) == 18);
+    cjson_object_set(&v, "key3", 4, NULL);
+    cjson_object_set(&v, "new", 3, NULL);
+    assert(cjson_find_object_index(&v, "key3", 4) == 19);
+    assert(cjson_find_object_index(&v, "new", 3) == 20);
+    assert(cjson_find_object_index(&v, "key0", 4) == 0);
+    cjson_free(&v);
+    cjson_arena_free(arena);
+    
+    printf("✓ test_object_mutation passed\n");
+}
+
+void test_copy_move() {
+    char json[2048];
+    size_t pos = (size_t)sprintf(json, "{\"list\": [1, -2, 3.5, \"short\", \"a string long enough for the heap\", {\"k\": [true, null]}],"
+                                       " \"a key long enough to live outside the member\": 18446744073709551615, \"wide\": {");
+    for (int i = 0; i < 30; i++)
+        pos += (size_t)sprintf(json + pos, "%s\"field%d\": \"value number %d\"", i ? ", " : "", i, i);
+    pos += (size_t)sprintf(json + pos, "}");
+    for (int i = 0; i < 20; i++)
+        pos += (size_t)sprintf(json + pos, ", \"top%d\": %d", i, i);
+    sprintf(json + pos, "}");
+    
+    cjson_value src, a, b;
+    cjson_init(&src);
+    assert(cjson_parse(&src, json) == CJSON_PARSE_OK);
+    char *expected = cjson_stringify(&src, NULL);
+    
+    // A heap copy is independent of its source and looks up keys as usual
+    cjson_init(&a);
+    cjson_copy(&a, &src, NULL);
+    cjson_free(&src);
+    char *out = cjson_stringify(&a, NULL);
+    assert(strcmp(out, expected) == 0);
+    free(out);
+    assert(strcmp(cjson_get_string(cjson_find_object_value(cjson_find_object_value(&a, "wide", 4), "field29", 7)), "value number 29") == 0);
+    assert(cjson_get_int64(cjson_find_object_value(&a, "top19", 5)) == 19);
+    
+    // Copies stay editable at every level, the root included
+    for (int i = 0; i < 40; i++) {
+        char key[16];
+        int len = sprintf(key, "new%d", i);
+        cjson_object_set(&a, key, (size_t)len, NULL);
+    }
+    cjson_value *list = cjson_find_object_value(&a, "list", 4);
+    cjson_array_push(list, NULL);
+    cjson_set_string(cjson_get_array_element(list, 3), "replaced with a longer string", 29);
+    cjson_object_remove(&a, "wide", 4);
+    assert(cjson_get_object_size(&a) == 62);
+    assert(cjson_find_object_index(&a, "new39", 5) == 61);
+    assert(cjson_get_array_size(list) == 7);
+    
+    // Copying again gives an equal document; copying over a value frees it first
+    cjson_init(&b);
+    cjson_set_string(&b, "freed when the copy replaces it", 31);
+    cjson_copy(&b, &a, NULL);
+    out = cjson_stringify(&a, NULL);
+    char *again = cjson_stringify(&b, NULL);
+    assert(strcmp(out, again) == 0);
+    free(out);
+    free(again);
+    cjson_free(&a);
+    
+    // A root array that starts its block can be emptied and refilled
+    cjson_copy(&a, cjson_find_object_value(&b, "list", 4), NULL);
+    cjson_array_erase(&a, 0, cjson_get_array_size(&a));
+    cjson_array_shrink_to_fit(&a);
+    cjson_array_push(&a, NULL);
+    out = cjson_stringify(&a, NULL);
+    assert(strcmp(out, "[null]") == 0);
+    free(out);
+    cjson_free(&a);
+    cjson_free(&b);
+    
+    // Arena copies, and copies of lazy documents and scalars
+    cjson_arena *arena = cjson_arena_new(0);
+    cjson_parse_options opts = {CJSON_PARSE_LAZY, NULL, NULL, NULL, NULL};
+    cjson_init(&src);
+    assert(cjson_parse_ex(&src, json, strlen(json), &opts) == CJSON_PARSE_OK);
+    cjson_init(&a);
+    cjson_copy(&a, &src, arena);
+    cjson_free(&src);
+    out = cjson_stringify(&a, NULL);
+    assert(strcmp(out, expected) == 0);
+    free(out);
+    assert(cjson_find_object_index(&a, "top0", 4) == 3);
+    cjson_free(&a);
+    cjson_arena_free(arena);
+    cjson_init(&src);
+    cjson_set_string(&src, "a root string long enough for the heap", 38);
+    cjson_copy(&a, &src, NULL);
+    assert(strcmp(cjson_get_string(&a), cjson_get_string(&src)) == 0 && cjson_get_string(&a) != cjson_get_string(&src));
+    cjson_free(&a);
+    cjson_free(&src);
+    cjson_set_uint64(&src, UINT64_MAX);
+    cjson_copy(&a, &src, NULL);
+    assert(cjson_get_uint64(&a) == UINT64_MAX);
+    cjson_free(&src);
+    free(expected);
+    
+    // Values moved out of a heap copy outlive it, grown containers included
+    cjson_value parts, text, moved;
+    cjson_init(&src);
+    assert(cjson_parse(&src, json) == CJSON_PARSE_OK);
+    cjson_init(&a);
+    cjson_copy(&a, &src, NULL);
+    cjson_free(&src);
+    cjson_init(&parts);
+    cjson_init(&text);
+    cjson_init(&moved);
+    cjson_set_object(&parts, 0);
+    list = cjson_find_object_value(&a, "list", 4);
+    cjson_object_set(&parts, "wide", 4, cjson_find_object_value(&a, "wide", 4));
+    cjson_array_push(list, NULL);
+    cjson_move(&text, cjson_get_array_element(list, 4));
+    cjson_swap(&moved, list);
+    cjson_object_set(&parts, "k", 1, cjson_get_array_element(&moved, 5));
+    cjson_free(&a);
+    assert(strcmp(cjson_get_string(&text), "a string long enough for the heap") == 0);
+    out = cjson_stringify(&moved, NULL);
+    assert(strcmp(out, "[1,-2,3.5,\"short\",null,null,null]") == 0);
+    free(out);
+    out = cjson_stringify(cjson_find_object_value(&parts, "k", 1), NULL);
+    assert(strcmp(out, "{\"k\":[true,null]}") == 0);
+    free(out);
+    cjson_value *wide = cjson_find_object_value(&parts, "wide", 4);
+    assert(strcmp(cjson_get_string(cjson_find_object_value(wide, "field29", 7)), "value number 29") == 0);
+    cjson_object_set(wide, "added", 5, NULL);
+    assert(cjson_find_object_index(wide, "added", 5) == 30);
+    cjson_free(&parts);
+    cjson_free(&text);
+    cjson_free(&moved);
+    
+    // Moves and swaps exchange values in O(1); member keys stay where they are
+    cjson_init(&src);
+    assert(cjson_parse(&src, "{\"k\": [1, 2], \"a key long enough to live outside the member\": \"v\"}") == CJSON_PARSE_OK);
+    cjson_swap(cjson_get_object_value(&src, 0), cjson_get_object_value(&src, 1));
+    out = cjson_stringify(&src, NULL);
+    assert(strcmp(out, "{\"k\":\"v\",\"a key long enough to live outside the member\":[1,2]}") == 0);
+    free(out);
+    cjson_init(&a);
+    cjson_set_string(&a, "freed by the move into it", 25);
+    cjson_move(&a, cjson_get_object_value(&src, 1));
+    assert(cjson_get_array_size(&a) == 2);
+    assert(cjson_get_object_value(&src, 1)->type == CJSON_NULL);
+    cjson_move(&a, &a);
+    assert(cjson_get_array_size(&a) == 2);
+    cjson_free(&a);
+    cjson_free(&src);
+    
+    // The source may be a part of the destination
+    cjson_init(&a);
+    assert(cjson_parse(&a, "{\"a\": {\"b\": [\"a string long enough for the heap\"]}, \"c\": 1}") == CJSON_PARSE_OK);
+    cjson_copy(&a, &a, NULL);
+    cjson_copy(&a, cjson_find_object_value(&a, "a", 1), NULL);
+    cjson_move(&a, cjson_find_object_value(&a, "b", 1));
+    cjson_copy(&a, cjson_get_array_element(&a, 0), NULL);
+    assert(strcmp(cjson_get_string(&a), "a string long enough for the heap") == 0);
+    cjson_free(&a);
+    
+    printf("✓ test_copy_move passed\n");
+}
+
 int main() {
     printf("Running memory management tests...\n\n");
     
     test_memory_cleanup();
     test_set_operations();
     test_multiple_operations();
+    test_arena_parse();
+    test_context_reuse();
+    test_value_layout();
+    test_short_strings();
+    test_key_table();
+    test_array_mutation();
+    test_object_mutation();
+    test_copy_move();
     
     printf("\n✅ All memory tests passed!\n");
     return 0;
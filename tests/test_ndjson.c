@@ -0,0 +1,79 @@
+#include "../CJson.h"
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <stdlib.h>
+
+void test_ndjson_records() {
+    const char *input = "{\"a\": 1}\n"
+                        "\n"
+                        "[1, 2]\r\n"
+                        "   \t\n"
+                        "{\"bad\": }\n"
+                        "\"last\"";
+    cjson_ndjson_record *records;
+    size_t count = cjson_parse_ndjson(input, strlen(input), 1, &records);
+    
+    // Blank lines are skipped; CRLF line ends are accepted
+    assert(count == 4);
+    assert(records[0].error == CJSON_PARSE_OK && records[0].v.type == CJSON_OBJECT);
+    assert(records[0].offset == 0 && records[0].length == 8);
+    assert(records[1].error == CJSON_PARSE_OK && cjson_get_array_size(&records[1].v) == 2);
+    assert(records[1].length == 6);
+    
+    // A bad line fails alone and points back into the input
+    assert(records[2].error == CJSON_INVALID_VALUE && records[2].v.type == CJSON_NULL);
+    assert(strncmp(input + records[2].offset, "{\"bad\": }", records[2].length) == 0);
+    
+    // The last line needs no newline
+    assert(strcmp(cjson_get_string(&records[3].v), "last") == 0);
+    cjson_ndjson_free(records, count);
+    
+    count = cjson_parse_ndjson("\n\n", 2, 0, &records);
+    assert(count == 0);
+    cjson_ndjson_free(records, count);
+    
+    printf("✓ test_ndjson_records passed\n");
+}
+
+void test_ndjson_threads() {
+    const size_t lines = 5000;
+    char *input = (char *)malloc(lines * 64);
+    size_t len = 0;
+    for (size_t i = 0; i < lines; i++) {
+        if (i % 97 == 0)
+            len += (size_t)sprintf(input + len, "{\"id\": %zu, oops}\n", i);
+        else
+            len += (size_t)sprintf(input + len, "{\"id\": %zu, \"name\": \"user%zu\", \"tags\": [1, 2.5]}\n", i, i);
+    }
+    
+    // Results come back in input order whatever the number of workers
+    unsigned thread_counts[] = {1, 2, 4, 0};
+    for (size_t t = 0; t < sizeof(thread_counts) / sizeof(thread_counts[0]); t++) {
+        cjson_ndjson_record *records;
+        size_t count = cjson_parse_ndjson(input, len, thread_counts[t], &records);
+        assert(count == lines);
+        for (size_t i = 0; i < lines; i++) {
+            if (i % 97 == 0) {
+                assert(records[i].error == CJSON_MISS_KEY);
+                continue;
+            }
+            assert(records[i].error == CJSON_PARSE_OK);
+            assert(cjson_get_int64(cjson_find_object_value(&records[i].v, "id", 2)) == (int64_t)i);
+        }
+        cjson_ndjson_free(records, count);
+    }
+    
+    free(input);
+    printf("✓ test_ndjson_threads passed\n");
+}
+
+int main() {
+    printf("Running NDJSON tests...\n\n");
+    
+    test_ndjson_records();
+    test_ndjson_threads();
+    
+    printf("\n✅ All NDJSON tests passed!\n");
+    return 0;
+}
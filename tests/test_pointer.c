@@ -0,0 +1,209 @@
+#include "../CJson.h"
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <stdlib.h>
+
+// The example document from RFC 6901, section 5
+static const char *rfc_doc =
+    "{\"foo\": [\"bar\", \"baz\"], \"\": 0, \"a/b\": 1, \"c%d\": 2, \"e^f\": 3,"
+    " \"g|h\": 4, \"i\\\\j\": 5, \"k\\\"l\": 6, \" \": 7, \"m~n\": 8}";
+
+void test_pointer_rfc() {
+    cjson_value v;
+    cjson_init(&v);
+    assert(cjson_parse(&v, rfc_doc) == CJSON_PARSE_OK);
+
+    assert(cjson_pointer_get(&v, "") == &v);
+    assert(cjson_pointer_get(&v, "/foo")->type == CJSON_ARRAY);
+    assert(strcmp(cjson_get_string(cjson_pointer_get(&v, "/foo/0")), "bar") == 0);
+    const char *pointers[] = {"/", "/a~1b", "/c%d", "/e^f", "/g|h", "/i\\j", "/k\"l", "/ ", "/m~0n"};
+    for (int i = 0; i < 9; i++) {
+        assert(cjson_get_int64(cjson_pointer_get(&v, pointers[i])) == i);
+        cjson_path *path = cjson_path_compile(pointers[i]);
+        assert(cjson_get_int64(cjson_path_get(path, &v)) == i);
+        cjson_path_free(path);
+    }
+
+    // Missing members, out of range or non-canonical indexes, and stepping into scalars
+    const char *missing[] = {"/bar", "/foo/2", "/foo/-", "/foo/01", "/foo/+1", "/foo/x", "/foo/0/0",
+                             "/foo/99999999999999999999999", "/a/b"};
+    for (int i = 0; i < 9; i++) {
+        assert(cjson_pointer_get(&v, missing[i]) == NULL);
+        cjson_path *path = cjson_path_compile(missing[i]);
+        assert(path != NULL && cjson_path_get(path, &v) == NULL);
+        cjson_path_free(path);
+    }
+
+    // Malformed pointers
+    const char *bad[] = {"foo", "/m~2n", "/m~", "/foo/0~"};
+    for (int i = 0; i < 4; i++) {
+        assert(cjson_pointer_get(&v, bad[i]) == NULL);
+        assert(cjson_path_compile(bad[i]) == NULL);
+    }
+
+    cjson_free(&v);
+    printf("✓ test_pointer_rfc passed\n");
+}
+
+void test_path_reuse() {
+    // Objects large enough for the hash index, reached through one compiled path
+    cjson_path *path = cjson_path_compile("/items/1/key~1with~0escapes/k17");
+    cjson_path *root = cjson_path_compile("");
+    char doc[1024];
+    for (int d = 0; d < 3; d++) {
+        int n = sprintf(doc, "{\"items\": [null, {\"key/with~escapes\": {");
+        for (int k = 0; k < 20; k++)
+            n += sprintf(doc + n, "%s\"k%d\": %d", k ? ", " : "", k, k * 10 + d);
+        sprintf(doc + n, "}}]}");
+
+        cjson_value v;
+        cjson_init(&v);
+        assert(cjson_parse(&v, doc) == CJSON_PARSE_OK);
+        assert(cjson_get_int64(cjson_path_get(path, &v)) == 170 + d);
+        assert(cjson_path_get(root, &v) == &v);
+        cjson_free(&v);
+
+        // Lazy documents decode only the levels the path walks through
+        cjson_parse_options opts = {CJSON_PARSE_LAZY, NULL, NULL, NULL, NULL};
+        cjson_init(&v);
+        assert(cjson_parse_ex(&v, doc, strlen(doc), &opts) == CJSON_PARSE_OK);
+        assert(cjson_get_int64(cjson_path_get(path, &v)) == 170 + d);
+        assert(cjson_get_int64(cjson_pointer_get(&v, "/items/1/key~1with~0escapes/k3")) == 30 + d);
+        cjson_free(&v);
+    }
+    cjson_path_free(path);
+    cjson_path_free(root);
+
+    // Keys longer than the on-stack unescape buffer
+    char key[200], pointer[2 * sizeof(key) + 4];
+    memset(key, 'q', sizeof(key) - 1);
+    key[sizeof(key) - 1] = '\0';
+    key[100] = '~';
+    sprintf(doc, "{\"%s\": true}", key);
+    key[100] = '\0';
+    sprintf(pointer, "/%s~0%s", key, key + 101);
+    cjson_value v;
+    cjson_init(&v);
+    assert(cjson_parse(&v, doc) == CJSON_PARSE_OK);
+    assert(cjson_pointer_get(&v, pointer)->type == CJSON_TRUE);
+    cjson_free(&v);
+
+    printf("✓ test_path_reuse passed\n");
+}
+
+static char *project(const char *json, const char **pointers, size_t count, unsigned flags, int *ret) {
+    cjson_path *paths[8];
+    for (size_t i = 0; i < count; i++)
+        paths[i] = cjson_path_compile(pointers[i]);
+    cjson_projection *projection = cjson_projection_new((const cjson_path *const *)paths, count);
+    cjson_parse_options opts = {flags, NULL, NULL, NULL, projection};
+    cjson_value v;
+    cjson_init(&v);
+    *ret = cjson_parse_ex(&v, json, strlen(json), &opts);
+    char *out = (*ret == CJSON_PARSE_OK) ? cjson_stringify(&v, NULL) : NULL;
+    cjson_free(&v);
+    cjson_projection_free(projection);
+    for (size_t i = 0; i < count; i++)
+        cjson_path_free(paths[i]);
+    return out;
+}
+
+void test_projection() {
+    const char *json = "{\"id\": 7, \"user\": {\"name\": \"Ann\", \"tags\": [\"a\", \"b\"], \"addr\": {\"city\": \"X\"}},"
+                       " \"items\": [{\"sku\": \"a\", \"qty\": 1}, {\"sku\": \"b\", \"qty\": 2}, {\"sku\": \"c\"}],"
+                       " \"blob\": \"}]\\\" not a bracket\", \"noise\": [[1, [2]], {\"x\": null}], \"id\": 8}";
+    unsigned modes[] = {0, CJSON_PARSE_SKIP_UNVALIDATED};
+    for (int mode = 0; mode < 2; mode++) {
+        int ret;
+        // Unselected members vanish, unselected elements before a selected one become null
+        const char *p1[] = {"/id", "/user/name", "/items/1/sku", "/missing", "/user/addr/city/deeper"};
+        char *out = project(json, p1, 5, modes[mode], &ret);
+        assert(ret == CJSON_PARSE_OK);
+        assert(strcmp(out, "{\"id\":7,\"user\":{\"name\":\"Ann\",\"addr\":{\"city\":\"X\"}},\"items\":[null,{\"sku\":\"b\"}],\"id\":8}") == 0);
+        free(out);
+
+        // A path that ends at a container keeps all of it, even if longer paths run through it
+        const char *p2[] = {"/user/tags/1", "/user", "/noise/0/1"};
+        out = project(json, p2, 3, modes[mode], &ret);
+        assert(strcmp(out, "{\"user\":{\"name\":\"Ann\",\"tags\":[\"a\",\"b\"],\"addr\":{\"city\":\"X\"}},\"noise\":[[null,[2]]]}") == 0);
+        free(out);
+
+        // The empty pointer selects everything, and no paths select nothing
+        cjson_value v;
+        cjson_init(&v);
+        assert(cjson_parse(&v, json) == CJSON_PARSE_OK);
+        char *expected = cjson_stringify(&v, NULL);
+        cjson_free(&v);
+        const char *p3[] = {"/id", ""};
+        out = project(json, p3, 2, modes[mode], &ret);
+        assert(strcmp(out, expected) == 0);
+        free(out);
+        free(expected);
+        out = project(json, NULL, 0, modes[mode], &ret);
+        assert(strcmp(out, "{}") == 0);
+        free(out);
+        out = project("[1, 2, 3]", p1, 1, modes[mode], &ret);
+        assert(strcmp(out, "[]") == 0);
+        free(out);
+    }
+
+    // Results resolve the projected paths like the full document does
+    cjson_path *paths[2] = {cjson_path_compile("/items/2/sku"), cjson_path_compile("/user/tags/0")};
+    cjson_projection *projection = cjson_projection_new((const cjson_path *const *)paths, 2);
+    cjson_arena *arena = cjson_arena_new(0);
+    cjson_parse_options opts = {CJSON_PARSE_STRUCTURAL_INDEX, arena, NULL, NULL, projection};
+    cjson_value v;
+    assert(cjson_parse_ex(&v, json, strlen(json), &opts) == CJSON_PARSE_OK);
+    assert(strcmp(cjson_get_string(cjson_path_get(paths[0], &v)), "c") == 0);
+    assert(strcmp(cjson_get_string(cjson_path_get(paths[1], &v)), "a") == 0);
+    assert(cjson_get_array_size(cjson_pointer_get(&v, "/items")) == 3);
+    cjson_free(&v);
+    cjson_arena_free(arena);
+    cjson_projection_free(projection);
+    cjson_path_free(paths[0]);
+    cjson_path_free(paths[1]);
+
+    printf("✓ test_projection passed\n");
+}
+
+void test_projection_errors() {
+    const char *keep[] = {"/a"};
+    int ret;
+    // Skipped subtrees are validated by default, and errors match cjson_parse()
+    const char *bad[] = {"{\"a\": 1, \"b\": [tru]}", "{\"a\": 1, \"b\": {\"c\" 1}}", "{\"a\": 1, \"b\": \"\\x\"}",
+                         "{\"b\": [1,], \"a\": 1}", "{\"a\": 1, \"b\": 01}"};
+    for (int i = 0; i < 5; i++) {
+        cjson_value v;
+        cjson_init(&v);
+        int expected = cjson_parse(&v, bad[i]);
+        cjson_free(&v);
+        assert(project(bad[i], keep, 1, 0, &ret) == NULL && ret == expected);
+
+        // Unvalidated skipping accepts them as long as the skipped token ends
+        char *out = project(bad[i], keep, 1, CJSON_PARSE_SKIP_UNVALIDATED, &ret);
+        assert(ret == CJSON_PARSE_OK && strcmp(out, "{\"a\":1}") == 0);
+        free(out);
+    }
+
+    // Selected values and the structure around skipped ones are still checked
+    const char *broken[] = {"{\"a\": tru, \"b\": 1}", "{\"b\": [1, 2", "{\"b\": \"open", "{\"b\": 1 \"a\": 1}", "{\"b\": }", "{\"b\":"};
+    for (int i = 0; i < 6; i++) {
+        assert(project(broken[i], keep, 1, 0, &ret) == NULL && ret != CJSON_PARSE_OK);
+        assert(project(broken[i], keep, 1, CJSON_PARSE_SKIP_UNVALIDATED, &ret) == NULL && ret != CJSON_PARSE_OK);
+    }
+
+    printf("✓ test_projection_errors passed\n");
+}
+
+int main() {
+    printf("Running JSON Pointer tests...\n\n");
+
+    test_pointer_rfc();
+    test_path_reuse();
+    test_projection();
+    test_projection_errors();
+
+    printf("\n✅ All JSON Pointer tests passed!\n");
+    return 0;
+}
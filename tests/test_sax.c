@@ -0,0 +1,137 @@
+#include "../CJson.h"
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+// Records every event as text so a whole parse can be compared at once
+typedef struct {
+    char log[1024];
+    size_t pos;
+    int stop_at_key; // abort when this key is seen, if non-zero
+} recorder;
+
+static void record(recorder *r, const char *text) {
+    r->pos += (size_t)snprintf(r->log + r->pos, sizeof(r->log) - r->pos, "%s ", text);
+}
+
+static int on_null(void *ud) { record(ud, "null"); return 0; }
+static int on_boolean(void *ud, int b) { record(ud, b ? "true" : "false"); return 0; }
+static int on_number(void *ud, const cjson_value *n) {
+    char buf[64];
+    if (cjson_get_number_type(n) == CJSON_NUMBER_INT64)
+        snprintf(buf, sizeof(buf), "i:%lld", (long long)cjson_get_int64(n));
+    else
+        snprintf(buf, sizeof(buf), "n:%g", cjson_get_number(n));
+    record(ud, buf);
+    return 0;
+}
+static int on_string(void *ud, const char *s, size_t len) {
+    char buf[64];
+    assert(strlen(s) == len);
+    snprintf(buf, sizeof(buf), "s:%s", s);
+    record(ud, buf);
+    return 0;
+}
+static int on_start_object(void *ud) { record(ud, "{"); return 0; }
+static int on_key(void *ud, const char *key, size_t len) {
+    recorder *r = ud;
+    char buf[64];
+    snprintf(buf, sizeof(buf), "k:%.*s", (int)len, key);
+    record(r, buf);
+    return r->stop_at_key && strcmp(key, "stop") == 0;
+}
+static int on_end_object(void *ud, size_t n) {
+    char buf[16];
+    snprintf(buf, sizeof(buf), "}%zu", n);
+    record(ud, buf);
+    return 0;
+}
+static int on_start_array(void *ud) { record(ud, "["); return 0; }
+static int on_end_array(void *ud, size_t n) {
+    char buf[16];
+    snprintf(buf, sizeof(buf), "]%zu", n);
+    record(ud, buf);
+    return 0;
+}
+
+static const cjson_sax_handler full = {on_null, on_boolean, on_number, on_string, on_start_object,
+                                       on_key, on_end_object, on_start_array, on_end_array};
+
+static int count_number(void *ud, const cjson_value *n) {
+    (void)n;
+    (*(size_t *)ud)++;
+    return 0;
+}
+
+static int sax(const char *json, recorder *r) {
+    memset(r, 0, sizeof(*r));
+    return cjson_parse_sax(json, strlen(json), &full, r);
+}
+
+void test_sax_events() {
+    recorder r;
+    
+    assert(sax(" {\"a\": [1, -2.5, \"x\\ty\", \"\"], \"b\": {}, \"c\": [], \"d\": [true, false, null]} ", &r) == CJSON_PARSE_OK);
+    assert(strcmp(r.log, "{ k:a [ i:1 n:-2.5 s:x\ty s: ]4 k:b { }0 k:c [ ]0 k:d [ true false null ]3 }4 ") == 0);
+    
+    assert(sax("\"\\u00e9\"", &r) == CJSON_PARSE_OK);
+    assert(strcmp(r.log, "s:\xC3\xA9 ") == 0);
+    
+    assert(sax("42", &r) == CJSON_PARSE_OK);
+    assert(strcmp(r.log, "i:42 ") == 0);
+    
+    printf("✓ test_sax_events passed\n");
+}
+
+void test_sax_partial_handler() {
+    // Only count numbers; every other callback is NULL
+    cjson_sax_handler h;
+    size_t count = 0;
+    memset(&h, 0, sizeof(h));
+    h.on_number = count_number;
+    const char *json = "{\"ids\": [1, 2, 3], \"name\": \"n\", \"nested\": [[4], {\"x\": 5}]}";
+    assert(cjson_parse_sax(json, strlen(json), &h, &count) == CJSON_PARSE_OK);
+    assert(count == 5);
+    
+    printf("✓ test_sax_partial_handler passed\n");
+}
+
+void test_sax_abort() {
+    recorder r;
+    memset(&r, 0, sizeof(r));
+    r.stop_at_key = 1;
+    const char *json = "{\"a\": 1, \"stop\": [2, 3], \"z\": 4}";
+    assert(cjson_parse_sax(json, strlen(json), &full, &r) == CJSON_SAX_ABORTED);
+    assert(strcmp(r.log, "{ k:a i:1 k:stop ") == 0);
+    
+    printf("✓ test_sax_abort passed\n");
+}
+
+void test_sax_errors() {
+    // The event parser reports exactly what cjson_parse reports
+    const char *cases[] = {"", "nul", "[1,]", "[1 2", "{\"a\" 1}", "{1: 2}", "{\"a\": 1 \"b\": 2}",
+                           "\"abc", "\"\\x\"", "\"\\uD800\"", "1e400", "01", "[] x", "{\"a\": [}"};
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        recorder r;
+        cjson_value v;
+        cjson_init(&v);
+        int expected = cjson_parse(&v, cases[i]);
+        assert(expected != CJSON_PARSE_OK);
+        assert(sax(cases[i], &r) == expected);
+        cjson_free(&v);
+    }
+    
+    printf("✓ test_sax_errors passed\n");
+}
+
+int main() {
+    printf("Running SAX parser tests...\n\n");
+    
+    test_sax_events();
+    test_sax_partial_handler();
+    test_sax_abort();
+    test_sax_errors();
+    
+    printf("\n✅ All SAX tests passed!\n");
+    return 0;
+}
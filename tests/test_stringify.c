@@ -3,6 +3,7 @@
 #include <string.h>
 #include <assert.h>
 #include <stdlib.h>
+#include <math.h>
 
 void test_stringify_basic() {
     cjson_value v;
@@ -77,6 +78,309 @@ void test_stringify_string() {
     printf("✓ test_stringify_string passed\n");
 }
 
+void test_stringify_escape_runs() {
+    const char special[] = {'\"', '\\', '\n', '\x1f', '\x7f', '/'};
+    const char *escaped[] = {"\\\"", "\\\\", "\\n", "\\u001F", "\x7f", "/"};
+    char str[80], expected[100];
+    cjson_value v;
+    
+    // One special byte at every position, on both sides of the short-string cutoff and the SIMD widths
+    for (size_t len = 1; len <= 70; len++) {
+        for (size_t pos = 0; pos < len; pos++) {
+            for (size_t k = 0; k < sizeof(special); k++) {
+                size_t n = 0, out_len;
+                memset(str, 'a', len);
+                str[pos] = special[k];
+                expected[n++] = '"';
+                memset(expected + n, 'a', pos);
+                n += pos;
+                memcpy(expected + n, escaped[k], strlen(escaped[k]));
+                n += strlen(escaped[k]);
+                memset(expected + n, 'a', len - pos - 1);
+                n += len - pos - 1;
+                expected[n++] = '"';
+                expected[n] = '\0';
+                
+                cjson_init(&v);
+                cjson_set_string(&v, str, len);
+                char *out = cjson_stringify(&v, &out_len);
+                assert(out_len == n && strcmp(out, expected) == 0);
+                assert(cjson_stringify_size(&v) == n);
+                free(out);
+                cjson_free(&v);
+            }
+        }
+    }
+    
+    printf("✓ test_stringify_escape_runs passed\n");
+}
+
+void test_stringify_integer() {
+    cjson_value v;
+    char *json_str;
+    
+    const char *cases[] = {"0", "7", "-7", "10", "99", "100", "-1234567890", "9007199254740993",
+                           "9223372036854775807", "-9223372036854775808", "18446744073709551615",
+                           "[1,-2,{\"id\":1234567890123456789}]"};
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        cjson_init(&v);
+        assert(cjson_parse(&v, cases[i]) == CJSON_PARSE_OK);
+        json_str = cjson_stringify(&v, NULL);
+        assert(strcmp(json_str, cases[i]) == 0);
+        free(json_str);
+        cjson_free(&v);
+    }
+    
+    cjson_init(&v);
+    cjson_set_int64(&v, INT64_C(-9000000000000000001));
+    json_str = cjson_stringify(&v, NULL);
+    assert(strcmp(json_str, "-9000000000000000001") == 0);
+    free(json_str);
+    
+    printf("✓ test_stringify_integer passed\n");
+}
+
+static int significant_digits(const char *json) {
+    int n = 0, zeros = 0;
+    for (; *json && *json != 'e'; json++) {
+        if (*json < '0' || *json > '9' || (*json == '0' && n == 0))
+            continue;
+        zeros = (*json == '0') ? zeros + 1 : 0;
+        n++;
+    }
+    return n - zeros;
+}
+
+void test_stringify_double() {
+    cjson_value v, parsed;
+    char *json_str;
+    
+    struct { double n; const char *json; } cases[] = {
+        {0.0, "0"}, {-0.0, "-0"}, {0.1, "0.1"}, {-1.5, "-1.5"}, {42.5, "42.5"}, {1e20, "100000000000000000000"},
+        {1e21, "1e+21"}, {1e-6, "0.000001"}, {1e-7, "1e-7"}, {123.456e-10, "1.23456e-8"},
+        {5e-324, "5e-324"}, {2.2250738585072014e-308, "2.2250738585072014e-308"},
+        {1.7976931348623157e308, "1.7976931348623157e+308"}, {0.30000000000000004, "0.30000000000000004"},
+        {1e23, "1e+23"}, {2.718316374298659e276, "2.718316374298659e+276"}, {30892612233637950.0, "30892612233637950"},
+        {6.0905456862798886e26, "6.0905456862798886e+26"}, {2023347301156851.2, "2023347301156851.2"}};
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        cjson_init(&v);
+        cjson_set_number(&v, cases[i].n);
+        json_str = cjson_stringify(&v, NULL);
+        assert(strcmp(json_str, cases[i].json) == 0);
+        free(json_str);
+    }
+    
+    cjson_set_number(&v, HUGE_VAL);
+    json_str = cjson_stringify(&v, NULL);
+    assert(strcmp(json_str, "null") == 0);
+    free(json_str);
+    
+    // Every finite double must read back exactly, from the fewest digits that can
+    uint64_t state = 88172645463325252u;
+    for (int i = 0; i < 100000; i++) {
+        double n;
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        memcpy(&n, &state, sizeof(n));
+        if (n != n || n - n != 0) continue;
+        cjson_set_number(&v, n);
+        json_str = cjson_stringify(&v, NULL);
+        cjson_init(&parsed);
+        assert(cjson_parse(&parsed, json_str) == CJSON_PARSE_OK);
+        assert(cjson_get_number(&parsed) == n);
+        int digits = significant_digits(json_str);
+        if (digits > 1) {
+            char shorter[32];
+            snprintf(shorter, sizeof(shorter), "%.*e", digits - 2, n);
+            assert(strtod(shorter, NULL) != n);
+        }
+        free(json_str);
+    }
+    
+    printf("✓ test_stringify_double passed\n");
+}
+
+typedef struct {
+    char *data;
+    size_t len;
+    size_t calls;
+    size_t max_chunk;
+    size_t fail_after; // fail this call, if non-zero
+} sink;
+
+static int sink_write(void *userdata, const char *data, size_t len) {
+    sink *s = (sink *)userdata;
+    if (++s->calls == s->fail_after)
+        return -1;
+    s->data = (char *)realloc(s->data, s->len + len);
+    memcpy(s->data + s->len, data, len);
+    s->len += len;
+    if (len > s->max_chunk)
+        s->max_chunk = len;
+    return 0;
+}
+
+void test_stringify_to() {
+    cjson_value v;
+    char *expected;
+    size_t expected_len;
+    
+    // Long escaped strings and many members cross the buffer boundary
+    char *long_str = (char *)malloc(20000);
+    for (size_t i = 0; i < 20000; i++)
+        long_str[i] = (i % 7 == 0) ? '\n' : (i % 11 == 0) ? '\x01' : (char)('a' + i % 26);
+    cjson_init(&v);
+    cjson_set_array(&v, 300);
+    for (size_t i = 0; i < 300; i++) {
+        cjson_value *e = &v.u.a.a[i];
+        cjson_init(e);
+        if (i % 100 == 0)
+            cjson_set_string(e, long_str, 20000 - i);
+        else if (i % 2)
+            cjson_set_number(e, i * 0.5);
+        else
+            cjson_set_string(e, "x\"y", 3);
+        v.u.a.size = i + 1;
+    }
+    free(long_str);
+    expected = cjson_stringify(&v, &expected_len);
+    
+    sink s = {NULL, 0, 0, 0, 0};
+    assert(cjson_stringify_to(&v, sink_write, &s) == 0);
+    assert(s.len == expected_len);
+    assert(memcmp(s.data, expected, expected_len) == 0);
+    assert(s.calls > 1 && s.max_chunk <= 4096);
+    free(s.data);
+    
+    // The first failing write stops the output and is returned
+    sink failing = {NULL, 0, 0, 0, 2};
+    assert(cjson_stringify_to(&v, sink_write, &failing) == -1);
+    assert(failing.calls == 2);
+    free(failing.data);
+    
+    free(expected);
+    cjson_free(&v);
+    
+    // Small values are written in a single call
+    sink small = {NULL, 0, 0, 0, 0};
+    cjson_init(&v);
+    assert(cjson_parse(&v, "{\"a\": [1, true, null, \"\"]}") == CJSON_PARSE_OK);
+    assert(cjson_stringify_to(&v, sink_write, &small) == 0);
+    assert(small.calls == 1 && small.len == 22 && memcmp(small.data, "{\"a\":[1,true,null,\"\"]}", 22) == 0);
+    free(small.data);
+    cjson_free(&v);
+    
+    printf("✓ test_stringify_to passed\n");
+}
+
+void test_stringify_into() {
+    const char *docs[] = {"null", "false", "0", "-1.5e-7", "\"\"", "\"tab\\there \\u0001 \\\" \\\\\"", "[]", "{}",
+                          "[1,2,3]", "{\"a\":{\"b\":[true,false,null]},\"c\":18446744073709551615}",
+                          "[0.1,0.2,0.30000000000000004,1e+21,123456789,-9223372036854775808,\"\\u001f\"]"};
+    char buf[256];
+    cjson_value v;
+    
+    for (size_t i = 0; i < sizeof(docs) / sizeof(docs[0]); i++) {
+        size_t len;
+        char *expected;
+        cjson_init(&v);
+        assert(cjson_parse(&v, docs[i]) == CJSON_PARSE_OK);
+        expected = cjson_stringify(&v, &len);
+        assert(cjson_stringify_size(&v) == len);
+        
+        // Every capacity: fits only with room for the terminator, never writes past cap
+        for (size_t cap = 0; cap <= len + 40; cap++) {
+            memset(buf, '#', sizeof(buf));
+            assert(cjson_stringify_into(&v, cap ? buf : NULL, cap) == len);
+            if (cap > len)
+                assert(strcmp(buf, expected) == 0);
+            for (size_t j = cap; j < sizeof(buf); j++)
+                assert(buf[j] == '#');
+        }
+        free(expected);
+        cjson_free(&v);
+    }
+    
+    printf("✓ test_stringify_into passed\n");
+}
+
+void test_stringify_ex() {
+    cjson_value v;
+    char *str;
+    size_t len;
+    
+    // No flags is the compact form
+    cjson_init(&v);
+    assert(cjson_parse(&v, "{\"b\":[1,2],\"a\":{},\"c\":[]}") == CJSON_PARSE_OK);
+    str = cjson_stringify_ex(&v, 0, &len);
+    assert(strcmp(str, "{\"b\":[1,2],\"a\":{},\"c\":[]}") == 0 && len == strlen(str));
+    free(str);
+    
+    // Indentation
+    str = cjson_stringify_ex(&v, CJSON_STRINGIFY_INDENT(2), &len);
+    assert(strcmp(str, "{\n  \"b\": [\n    1,\n    2\n  ],\n  \"a\": {},\n  \"c\": []\n}") == 0 && len == strlen(str));
+    free(str);
+    
+    // Sorted keys, combined with indentation
+    str = cjson_stringify_ex(&v, CJSON_STRINGIFY_SORT_KEYS, NULL);
+    assert(strcmp(str, "{\"a\":{},\"b\":[1,2],\"c\":[]}") == 0);
+    free(str);
+    str = cjson_stringify_ex(&v, CJSON_STRINGIFY_SORT_KEYS | CJSON_STRINGIFY_INDENT(1), NULL);
+    assert(strcmp(str, "{\n \"a\": {},\n \"b\": [\n  1,\n  2\n ],\n \"c\": []\n}") == 0);
+    free(str);
+    cjson_free(&v);
+    
+    // RFC 8785 section 3.2.2 sample
+    cjson_init(&v);
+    assert(cjson_parse(&v, "{\"numbers\": [333333333.33333329, 1E30, 4.50, 2e-3, 0.000000000000000000000000001],"
+                           " \"string\": \"\\u20ac$\\u000F\\u000aA'\\u0042\\u0022\\u005c\\\\\\\"\\/\","
+                           " \"literals\": [null, true, false]}") == CJSON_PARSE_OK);
+    str = cjson_stringify_ex(&v, CJSON_STRINGIFY_CANONICAL | CJSON_STRINGIFY_INDENT(4), NULL);
+    assert(strcmp(str, "{\"literals\":[null,true,false],\"numbers\":[333333333.3333333,1e+30,4.5,0.002,1e-27],"
+                       "\"string\":\"\xe2\x82\xac$\\u000f\\nA'B\\\"\\\\\\\\\\\"/\"}") == 0);
+    free(str);
+    cjson_free(&v);
+    
+    // RFC 8785 section 3.2.3: keys sort by UTF-16 code units, so U+1F600 comes before U+FB33
+    cjson_init(&v);
+    assert(cjson_parse(&v, "{\"\\u20ac\": 1, \"\\r\": 2, \"\\ufb33\": 3, \"1\": 4,"
+                           " \"\\ud83d\\ude00\": 5, \"\\u0080\": 6, \"\\u00f6\": 7}") == CJSON_PARSE_OK);
+    str = cjson_stringify_ex(&v, CJSON_STRINGIFY_CANONICAL, NULL);
+    assert(strcmp(str, "{\"\\r\":2,\"1\":4,\"\xc2\x80\":6,\"\xc3\xb6\":7,\"\xe2\x82\xac\":1,"
+                       "\"\xf0\x9f\x98\x80\":5,\"\xef\xac\xb3\":3}") == 0);
+    free(str);
+    cjson_free(&v);
+    
+    // Canonical numbers are doubles: -0 is 0, integers round, and digits are the shortest
+    cjson_init(&v);
+    assert(cjson_parse(&v, "[-0, 9007199254740993, -0.0, 1.8305252769034021e208, 1e23, 5e-324]") == CJSON_PARSE_OK);
+    str = cjson_stringify_ex(&v, CJSON_STRINGIFY_CANONICAL, NULL);
+    assert(strcmp(str, "[0,9007199254740992,0,1.830525276903402e+208,1e+23,5e-324]") == 0);
+    free(str);
+    cjson_free(&v);
+    
+    // Objects too large for the on-stack member order
+    char doc[512], *q = doc;
+    q += sprintf(q, "{");
+    for (int i = 39; i >= 0; i--)
+        q += sprintf(q, "\"k%02d\":%d%s", i, i, i ? "," : "}");
+    cjson_init(&v);
+    assert(cjson_parse(&v, doc) == CJSON_PARSE_OK);
+    str = cjson_stringify_ex(&v, CJSON_STRINGIFY_SORT_KEYS, NULL);
+    assert(strncmp(str, "{\"k00\":0,\"k01\":1,", 17) == 0 && strstr(str, "\"k38\":38,\"k39\":39}") != NULL);
+    free(str);
+    cjson_free(&v);
+    
+    // Non-finite numbers have no canonical form
+    cjson_init(&v);
+    cjson_set_number(&v, HUGE_VAL);
+    assert(cjson_stringify_ex(&v, CJSON_STRINGIFY_CANONICAL, NULL) == NULL);
+    cjson_free(&v);
+    
+    printf("✓ test_stringify_ex passed\n");
+}
+
 void test_round_trip() {
     cjson_value original, parsed;
     char *json_str;
@@ -117,6 +421,12 @@ int main() {
     
     test_stringify_basic();
     test_stringify_string();
+    test_stringify_escape_runs();
+    test_stringify_integer();
+    test_stringify_double();
+    test_stringify_to();
+    test_stringify_into();
+    test_stringify_ex();
     test_round_trip();
     
     printf("\n✅ All stringify tests passed!\n");